@@ -0,0 +1,91 @@
+//usr/bin/g++ --std=c++20 -O2 -Wall $0 circular_buffer.cpp -o ${o=`mktemp`} && exec $o $*
+#include "circular_buffer.hpp"
+#include <chrono>
+#include <iostream>
+
+constexpr int OPERATIONS = 50000000;
+
+struct Sample {
+	int32_t value;
+	int32_t channel;
+};
+
+// Keeps the queue half full, pushing and popping one at a time
+template <typename Queue>
+void measure(const char* name) {
+	static Queue queue;
+	for (int i = 0; i < Queue::capacity / 2; i++)
+		queue.pushBack({i, 0});
+	int64_t sum = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < OPERATIONS; i++) {
+		queue.pushBack({i, i & 7});
+		sum += queue.front().value;
+		queue.popFront();
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	while (!queue.empty())
+		queue.popFront();
+	std::cout << name << ": " << seconds * 1e9 / OPERATIONS << " ns per push and pop (checksum " << sum << ")" << std::endl;
+}
+
+template <typename Key>
+struct Record {
+	Key key;
+	float value;
+	int32_t flags;
+};
+
+// Full buffer, looking up keys that are there
+template <typename Key, int CAPACITY, bool KEY_COLUMN>
+void measureLookup() {
+	constexpr int LOOKUPS = 2000000;
+	using Buffer = CircularBuffer<Record<Key>, &Record<Key>::key, CAPACITY, InlineEngine, KEY_COLUMN>;
+	static Buffer buffer;
+	for (int i = 0; i < CAPACITY; i++)
+		buffer.insert({Key(i * 7), float(i), 0});
+	float sum = 0;
+	uint32_t random = 1;
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < LOOKUPS; i++) {
+		random = random * 1664525 + 1013904223;
+		if (std::optional<Record<Key>> found = buffer.tryGet(Key((random >> 8) % CAPACITY * 7)))
+			sum += found->value;
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::cout << "  " << (KEY_COLUMN ? "key column" : "records   ") << ", " << sizeof(Key) << " byte keys, capacity " << CAPACITY << ": "
+			<< seconds * 1e9 / LOOKUPS << " ns per lookup (checksum " << sum << ")" << std::endl;
+}
+
+template <typename Key>
+void measureLookups() {
+	measureLookup<Key, 16, false>();
+	measureLookup<Key, 16, true>();
+	measureLookup<Key, 64, false>();
+	measureLookup<Key, 64, true>();
+	measureLookup<Key, 256, false>();
+	measureLookup<Key, 256, true>();
+	measureLookup<Key, 1024, false>();
+	measureLookup<Key, 1024, true>();
+}
+
+int main() {
+	measure<CircularQueue<Sample, 256>>("Compact engine, capacity 256");
+	measure<CircularQueue<Sample, 256, InlineEngine>>("Inline engine, capacity 256");
+	measure<CircularQueue<Sample, 250>>("Compact engine, capacity 250");
+	measure<CircularQueue<Sample, 250, InlineEngine>>("Inline engine, capacity 250");
+	measure<CircularQueue<Sample, 1 << 20, InlineEngine>>("Inline engine, capacity 1048576");
+
+	std::cout << "Lookups";
+#if defined(__AVX2__)
+	std::cout << " (AVX2)";
+#elif defined(__SSE2__)
+	std::cout << " (SSE2)";
+#elif defined(__ARM_NEON)
+	std::cout << " (NEON)";
+#endif
+	std::cout << std::endl;
+	measureLookups<uint16_t>();
+	measureLookups<uint32_t>();
+	measureLookups<uint64_t>();
+}
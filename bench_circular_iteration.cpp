@@ -0,0 +1,68 @@
+//usr/bin/g++ --std=c++20 -O2 -Wall $0 circular_buffer.cpp -o ${o=`mktemp`} -ltbb && exec $o $*
+#include "circular_buffer.hpp"
+#include <algorithm>
+#include <chrono>
+#include <execution>
+#include <iostream>
+#include <numeric>
+
+constexpr int CAPACITY = 16384;
+constexpr int REPEATS = 2000;
+
+using Queue = CircularQueue<float, CAPACITY>;
+
+// Without iterators, the elements had to be taken out and put back
+float sumByCopying(Queue& queue) {
+	static std::array<float, CAPACITY> copy;
+	int size = queue.size();
+	for (int i = 0; i < size; i++) {
+		copy[i] = queue.front();
+		queue.popFront();
+		queue.pushBack(copy[i]);
+	}
+	return std::accumulate(copy.begin(), copy.begin() + size, 0.0f);
+}
+
+float sumThroughIterators(Queue& queue) {
+	return std::accumulate(queue.begin(), queue.end(), 0.0f);
+}
+
+float sumThroughSpans(Queue& queue) {
+	float sum = 0;
+	for (std::span<float> part : queue.peek())
+		sum = std::accumulate(part.begin(), part.end(), sum);
+	return sum;
+}
+
+template <typename Policy>
+float sumInParallel(Queue& queue, Policy policy) {
+	return std::transform_reduce(policy, queue.begin(), queue.end(), 0.0f, std::plus<>(), [] (float element) { return element * 2; }) / 2;
+}
+
+template <typename Summing>
+void measure(const char* name, Queue& queue, Summing sum) {
+	float checksum = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < REPEATS; i++)
+		checksum += sum(queue);
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::cout << name << ": " << seconds * 1e6 / REPEATS << " us per pass (checksum " << checksum << ")" << std::endl;
+}
+
+int main() {
+	static Queue queue;
+	for (int i = 0; i < CAPACITY; i++)
+		queue.pushBack(float(i % 100));
+	for (int i = 0; i < CAPACITY / 3; i++) { // The content wraps
+		queue.popFront();
+		queue.pushBack(float(i % 100));
+	}
+	std::cout << "Summing " << queue.size() << " floats" << std::endl;
+	measure("Copied out", queue, sumByCopying);
+	measure("Iterators", queue, sumThroughIterators);
+	measure("Two spans", queue, sumThroughSpans);
+	measure("transform_reduce, seq", queue, [] (Queue& queue) { return sumInParallel(queue, std::execution::seq); });
+	measure("transform_reduce, unseq", queue, [] (Queue& queue) { return sumInParallel(queue, std::execution::unseq); });
+	measure("transform_reduce, par", queue, [] (Queue& queue) { return sumInParallel(queue, std::execution::par); });
+	measure("transform_reduce, par_unseq", queue, [] (Queue& queue) { return sumInParallel(queue, std::execution::par_unseq); });
+}
@@ -0,0 +1,138 @@
+//usr/bin/g++ --std=c++17 -O2 -Wall $0 circular_buffer.cpp -o ${o=`mktemp`} -pthread && exec $o $*
+#include "concurrent_queue.hpp"
+#include "circular_buffer.hpp"
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+constexpr int COUNT = 10000000;
+constexpr int CAPACITY = 256;
+
+struct Sample {
+	int32_t value;
+	int32_t channel;
+};
+
+// The way it's done without SpscQueue
+struct LockedQueue {
+	CircularQueue<Sample, CAPACITY> queue;
+	std::mutex mutex;
+
+	bool pushBack(const Sample& sample) {
+		std::lock_guard lock(mutex);
+		if (queue.full())
+			return false;
+		queue.pushBack(sample);
+		return true;
+	}
+
+	bool popFront(Sample& into) {
+		std::lock_guard lock(mutex);
+		if (queue.empty())
+			return false;
+		into = queue.front();
+		queue.popFront();
+		return true;
+	}
+};
+
+struct UnlockedQueue {
+	SpscQueue<Sample, CAPACITY> queue;
+
+	bool pushBack(const Sample& sample) {
+		return queue.pushBack(sample);
+	}
+
+	bool popFront(Sample& into) {
+		if (queue.empty())
+			return false;
+		into = queue.front();
+		queue.popFront();
+		return true;
+	}
+};
+
+template <typename Queue>
+void measure(const char* name) {
+	Queue queue;
+	auto start = std::chrono::steady_clock::now();
+	std::thread producer([&] {
+		for (int i = 0; i < COUNT; i++)
+			while (!queue.pushBack({i, i & 7}))
+				std::this_thread::yield();
+	});
+	int64_t sum = 0;
+	Sample got;
+	for (int i = 0; i < COUNT; i++) {
+		while (!queue.popFront(got))
+			std::this_thread::yield();
+		sum += got.value;
+	}
+	producer.join();
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::cout << name << ": " << int64_t(COUNT / seconds) << " elements/s (checksum " << sum << ")" << std::endl;
+}
+
+struct SharedLockedQueue : LockedQueue {
+	bool tryPush(const Sample& sample) {
+		return pushBack(sample);
+	}
+	int tryPopBulk(Sample* into, int count) {
+		std::lock_guard lock(mutex);
+		int popped = 0;
+		for (; popped < count && !queue.empty(); popped++) {
+			into[popped] = queue.front();
+			queue.popFront();
+		}
+		return popped;
+	}
+};
+
+// As many producers as consumers, consumers pop in batches
+template <typename Queue>
+void measureContention(const char* name, int threads) {
+	constexpr int BATCH = 8;
+	int perProducer = COUNT / 10 / threads;
+	Queue queue;
+	std::atomic<int> received = 0;
+	std::atomic<int64_t> sum = 0;
+	std::vector<std::thread> running;
+	auto start = std::chrono::steady_clock::now();
+	for (int t = 0; t < threads; t++) {
+		running.emplace_back([&] {
+			for (int i = 0; i < perProducer; i++)
+				while (!queue.tryPush({i, i & 7}))
+					std::this_thread::yield();
+		});
+		running.emplace_back([&] {
+			Sample batch[BATCH];
+			int64_t partial = 0;
+			while (received.load(std::memory_order_relaxed) < perProducer * threads) {
+				int got = queue.tryPopBulk(batch, BATCH);
+				for (int i = 0; i < got; i++)
+					partial += batch[i].value;
+				if (got)
+					received += got;
+				else
+					std::this_thread::yield();
+			}
+			sum += partial;
+		});
+	}
+	for (std::thread& thread : running)
+		thread.join();
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::cout << name << ", " << threads << "+" << threads << " threads: " << int64_t(perProducer * threads / seconds) << " elements/s (checksum " << sum << ")" << std::endl;
+}
+
+int main() {
+	std::cout << "Hardware threads: " << std::thread::hardware_concurrency() << std::endl;
+	measure<LockedQueue>("CircularQueue with a mutex");
+	measure<UnlockedQueue>("SpscQueue");
+	for (int threads = 1; threads <= 16; threads *= 2) {
+		measureContention<SharedLockedQueue>("CircularQueue with a mutex", threads);
+		measureContention<MpmcQueue<Sample, CAPACITY>>("MpmcQueue", threads);
+	}
+}
@@ -0,0 +1,59 @@
+//usr/bin/g++ --std=c++20 -O2 -Wall $0 -o ${o=`mktemp`} && exec $o $*
+#include "function.hpp"
+#include <chrono>
+#include <functional>
+#include <iostream>
+
+constexpr int CALLS = 100000000;
+
+struct Frame {
+	int64_t values[16];
+};
+
+int64_t increment(int64_t value) {
+	return value + 1;
+}
+
+int64_t decrement(int64_t value) {
+	return value - 1;
+}
+
+// Alternates between two callables, so that the compiler can't tell which one is called
+template <typename Callable, typename Argument>
+void measure(const char* name, Callable (&callables)[2], Argument argument) {
+	int64_t sum = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < CALLS; i++) {
+		sum += callables[i & 1](argument);
+		asm volatile("" : : : "memory");
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::cout << name << ": " << seconds * 1e9 / CALLS << " ns per call (checksum " << sum << ")" << std::endl;
+}
+
+int main() {
+	int64_t offset = 3;
+	auto add = [offset](int64_t value) { return value + offset; };
+	auto subtract = [offset](int64_t value) { return value - offset; };
+	auto first = [](const Frame& frame) { return frame.values[0]; };
+	auto last = [](const Frame& frame) { return frame.values[15]; };
+
+	std::cout << "Small argument" << std::endl;
+	int64_t (*pointers[2])(int64_t) = { increment, decrement };
+	measure("Raw pointer", pointers, int64_t(1));
+	Function<int64_t(int64_t), 0> stateless[2] = { [](int64_t value) { return value + 1; }, [](int64_t value) { return value - 1; } };
+	measure("Function, stateless", stateless, int64_t(1));
+	Function<int64_t(int64_t)> functions[2] = { add, subtract };
+	measure("Function, capturing", functions, int64_t(1));
+	std::function<int64_t(int64_t)> standard[2] = { add, subtract };
+	measure("std::function", standard, int64_t(1));
+
+	std::cout << "Large argument by value" << std::endl;
+	Frame frame = {};
+	int64_t (*framePointers[2])(Frame) = { [](Frame frame) { return frame.values[0]; }, [](Frame frame) { return frame.values[15]; } };
+	measure("Raw pointer", framePointers, frame);
+	Function<int64_t(Frame), 0> frameFunctions[2] = { first, last };
+	measure("Function", frameFunctions, frame);
+	std::function<int64_t(Frame)> frameStandard[2] = { first, last };
+	measure("std::function", frameStandard, frame);
+}
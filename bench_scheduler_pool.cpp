@@ -0,0 +1,42 @@
+//usr/bin/g++ --std=c++20 -O2 -Wall $0 scheduler.cpp -o ${o=`mktemp`} && exec $o $*
+#include "scheduler_pool.hpp"
+#include <iostream>
+
+constexpr int TASKS = 256;
+constexpr int STEPS = 100; // Average
+constexpr int WORK_PER_STEP = 5000;
+
+// Tasks have different lengths, so that the round robin assignment leaves some threads with more work
+Task compute(int steps, std::atomic<int>& finished, std::atomic<uint64_t>& sink) {
+	uint64_t value = 0;
+	for (int step = 0; step < steps; step++) {
+		for (int i = 0; i < WORK_PER_STEP; i++)
+			value = value * 6364136223846793005ull + 1442695040888963407ull;
+		co_await waitForMs(0);
+	}
+	sink += value;
+	finished++;
+}
+
+template <int threads>
+void measure() {
+	std::atomic<int> finished = 0;
+	std::atomic<uint64_t> sink = 0;
+	SchedulerPool<threads, TASKS> pool;
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < TASKS; i++)
+		pool.addTask(compute(STEPS * (i % 16 + 1) * 2 / 17, finished, sink));
+	while (finished < TASKS)
+		std::this_thread::sleep_for(std::chrono::microseconds(100));
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::cout << threads << " threads: " << int(TASKS * STEPS / seconds) << " steps/s (" << seconds * 1000 << " ms)" << std::endl;
+}
+
+int main() {
+	std::cout << "Hardware threads: " << std::thread::hardware_concurrency() << std::endl;
+	measure<1>();
+	measure<2>();
+	measure<4>();
+	measure<8>();
+	measure<16>();
+}
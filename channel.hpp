@@ -0,0 +1,222 @@
+#ifndef CHANNEL_DUGI_HPP
+#define CHANNEL_DUGI_HPP
+
+#include "scheduler.hpp"
+#include "circular_buffer.hpp"
+#include <optional>
+
+// A queue between coroutines, tasks that can't send or receive are parked in the scheduler until they can
+template <typename T, int CAPACITY = 8>
+class Channel {
+	struct Waiter {
+		SchedulerBase* scheduler = nullptr;
+		int task = 0;
+		Waiter* next = nullptr;
+		bool waiting = false;
+	};
+
+	struct WaitList {
+		Waiter* first = nullptr;
+		Waiter* last = nullptr;
+
+		void append(Waiter* added) {
+			added->next = nullptr;
+			added->waiting = true;
+			if (last)
+				last->next = added;
+			else
+				first = added;
+			last = added;
+		}
+
+		Waiter* take() {
+			Waiter* taken = first;
+			if (taken) {
+				first = taken->next;
+				if (!first)
+					last = nullptr;
+				taken->waiting = false;
+			}
+			return taken;
+		}
+
+		void remove(Waiter* removed) {
+			Waiter* previous = nullptr;
+			for (Waiter* it = first; it; previous = it, it = it->next) {
+				if (it == removed) {
+					(previous ? previous->next : first) = it->next;
+					if (last == it)
+						last = previous;
+					removed->waiting = false;
+					return;
+				}
+			}
+		}
+	};
+
+	struct WaitingSender : Waiter {
+		T value;
+	};
+
+	struct WaitingReceiver : Waiter {
+		void (*deliver)(WaitingReceiver* self, const T& value);
+	};
+
+	CircularQueue<T, CAPACITY> _queue;
+	WaitList _senders;
+	WaitList _receivers;
+
+	template <typename Awaiting>
+	void park(Awaiting* waiter, WaitList& list, std::coroutine_handle<> handle) {
+		waiter->scheduler = TaskBase::getScheduler();
+		waiter->task = waiter->scheduler->thisTaskIsParked(handle);
+		list.append(waiter);
+	}
+
+	static void unpark(Waiter* waiter) {
+		waiter->scheduler->unpark(waiter->task);
+	}
+
+	void refill() {
+		// A place was freed, a waiting sender can put its value there
+		if (WaitingSender* sender = static_cast<WaitingSender*>(_senders.take())) {
+			_queue.pushBack(sender->value);
+			unpark(sender);
+		}
+	}
+
+	template <typename Awaiting>
+	struct Unlinking : Awaiting {
+		Channel* channel;
+		WaitList* list;
+		Unlinking(Channel* channel, WaitList* list) : channel(channel), list(list) {}
+		Unlinking(const Unlinking&) = delete;
+		~Unlinking() {
+			if (this->waiting) // The task was destroyed while parked
+				list->remove(this);
+		}
+	};
+
+public:
+	Channel() = default;
+	Channel(const Channel&) = delete;
+
+	bool trySend(const T& value) {
+		if (WaitingReceiver* receiver = static_cast<WaitingReceiver*>(_receivers.take())) {
+			receiver->deliver(receiver, value);
+			unpark(receiver);
+			return true;
+		}
+		if (_queue.full())
+			return false;
+		_queue.pushBack(value);
+		return true;
+	}
+
+	std::optional<T> tryReceive() {
+		if (_queue.empty())
+			return std::nullopt;
+		T received = _queue.front();
+		_queue.popFront();
+		refill();
+		return received;
+	}
+
+	template <int OTHER_CAPACITY>
+	int tryReceiveAll(CircularQueue<T, OTHER_CAPACITY>& into) {
+		int received = 0;
+		while (!_queue.empty() && !into.full()) {
+			into.pushBack(_queue.front());
+			_queue.popFront();
+			refill();
+			received++;
+		}
+		return received;
+	}
+
+	struct SendAwaiter : Unlinking<WaitingSender> {
+		SendAwaiter(Channel* channel, const T& value) : Unlinking<WaitingSender>(channel, &channel->_senders) {
+			this->value = value;
+		}
+		bool await_ready() {
+			return this->channel->trySend(this->value);
+		}
+		void await_suspend(std::coroutine_handle<> handle) {
+			this->channel->park(this, this->channel->_senders, handle);
+		}
+		void await_resume() {} // A receiver has already taken the value
+	};
+
+	struct ReceiveAwaiter : Unlinking<WaitingReceiver> {
+		T received;
+		ReceiveAwaiter(Channel* channel) : Unlinking<WaitingReceiver>(channel, &channel->_receivers) {
+			this->deliver = [] (WaitingReceiver* self, const T& value) {
+				static_cast<ReceiveAwaiter*>(self)->received = value;
+			};
+		}
+		bool await_ready() {
+			std::optional<T> got = this->channel->tryReceive();
+			if (got)
+				received = *got;
+			return bool(got);
+		}
+		void await_suspend(std::coroutine_handle<> handle) {
+			this->channel->park(this, this->channel->_receivers, handle);
+		}
+		T await_resume() {
+			return received;
+		}
+	};
+
+	template <int OTHER_CAPACITY>
+	struct ReceiveAllAwaiter : Unlinking<WaitingReceiver> {
+		CircularQueue<T, OTHER_CAPACITY>* into;
+		int received = 0;
+		ReceiveAllAwaiter(Channel* channel, CircularQueue<T, OTHER_CAPACITY>* into)
+				: Unlinking<WaitingReceiver>(channel, &channel->_receivers), into(into) {
+			this->deliver = [] (WaitingReceiver* self, const T& value) {
+				ReceiveAllAwaiter* awaiter = static_cast<ReceiveAllAwaiter*>(self);
+				awaiter->into->pushBack(value);
+				awaiter->received++;
+			};
+		}
+		bool await_ready() {
+			received = this->channel->tryReceiveAll(*into);
+			return received > 0 || into->full();
+		}
+		void await_suspend(std::coroutine_handle<> handle) {
+			this->channel->park(this, this->channel->_receivers, handle);
+		}
+		int await_resume() {
+			// Whatever was sent between being woken up and resumed is collected too
+			return received + this->channel->tryReceiveAll(*into);
+		}
+	};
+
+	SendAwaiter send(const T& value) {
+		return SendAwaiter(this, value);
+	}
+
+	ReceiveAwaiter receive() {
+		return ReceiveAwaiter(this);
+	}
+
+	// Appends everything that is in the channel (as much as fits), waits if there's nothing, returns how many were received
+	template <int OTHER_CAPACITY>
+	ReceiveAllAwaiter<OTHER_CAPACITY> receiveAll(CircularQueue<T, OTHER_CAPACITY>& into) {
+		return ReceiveAllAwaiter<OTHER_CAPACITY>(this, &into);
+	}
+
+	int size() const {
+		return _queue.size();
+	}
+	bool empty() const {
+		return _queue.empty();
+	}
+	bool full() const {
+		return _queue.full();
+	}
+	constexpr static int capacity = CAPACITY;
+};
+
+#endif // CHANNEL_DUGI_HPP
@@ -1,5 +1,13 @@
 #include "circular_buffer.hpp"
 #include <cstring>
+#include <algorithm>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
 
 CircularBufferImpl::CircularBufferImpl(uint8_t* data, short int capacity, short int elementSize) :
 	_data(data),
@@ -7,13 +15,22 @@ CircularBufferImpl::CircularBufferImpl(uint8_t* data, short int capacity, short
 	_elementSize(elementSize) {
 	}
 
-void CircularBufferImpl::pushBack(const void* data) {
+bool CircularBufferImpl::pushBack(const void* data) {
+	if (full())
+	return false;
 	if (_lastInserted >= 0)
 	_lastInserted = (_lastInserted + 1) % _capacity;
 	else {
 	_lastInserted = _firstInserted;
 	}
 	memcpy(_data + _lastInserted * _elementSize, data, size_t(_elementSize));
+	return true;
+}
+
+void CircularBufferImpl::pushBackOverwriting(const void* data) {
+	if (full())
+	popFront();
+	pushBack(data);
 }
 
 void* CircularBufferImpl::front() const {
@@ -27,37 +44,227 @@ void CircularBufferImpl::popFront() {
 	_lastInserted = -1;
 }
 
-bool CircularBufferImpl::find(uint8_t* sequence, int from, int till, uint8_t* copyLocation, bool erase) {
+void* CircularBufferImpl::back() const {
+	return (_data + _lastInserted * _elementSize);
+}
+
+void CircularBufferImpl::popBack() {
+	if (_lastInserted == _firstInserted)
+	_lastInserted = -1;
+	else
+	_lastInserted = (_lastInserted + _capacity - 1) % _capacity;
+}
+
+int CircularBufferImpl::pushBackBulk(const void* data, int count) {
+	count = std::min(count, _capacity - size());
+	if (count <= 0)
+	return 0;
+	int start = (_lastInserted == -1) ? _firstInserted : (_lastInserted + 1) % _capacity;
+	int beforeWrap = std::min(count, _capacity - start);
+	memcpy(_data + start * _elementSize, data, size_t(beforeWrap) * _elementSize);
+	memcpy(_data, static_cast<const uint8_t*>(data) + beforeWrap * _elementSize, size_t(count - beforeWrap) * _elementSize);
+	_lastInserted = (start + count - 1) % _capacity;
+	return count;
+}
+
+int CircularBufferImpl::popFrontBulk(void* into, int count) {
+	count = std::min(count, size());
+	if (count <= 0)
+	return 0;
+	int beforeWrap = std::min(count, _capacity - _firstInserted);
+	memcpy(into, _data + _firstInserted * _elementSize, size_t(beforeWrap) * _elementSize);
+	memcpy(static_cast<uint8_t*>(into) + beforeWrap * _elementSize, _data, size_t(count - beforeWrap) * _elementSize);
+	commit(count);
+	return count;
+}
+
+void CircularBufferImpl::commit(int count) {
+	if (count >= size()) {
+	_firstInserted = (_lastInserted + 1) % _capacity;
+	_lastInserted = -1;
+	} else
+	_firstInserted = (_firstInserted + count) % _capacity;
+}
+
+int CircularBufferImpl::contiguousSize() const {
 	if (_lastInserted == -1)
-	return false;
-	for (int i = _firstInserted; i <= _lastInserted; i = (i + 1) % _capacity) {
-	bool matches = true;
-	int offset = i * _elementSize + from;
-	for (int j = 0; j < till - from; j++)
-		if (sequence[j] != _data[offset + j]) {
-			matches = false;
-		break;
+	return 0;
+	if (_lastInserted >= _firstInserted)
+	return _lastInserted - _firstInserted + 1;
+	return _capacity - _firstInserted;
+}
+
+bool CircularBufferImpl::find(uint8_t* sequence, int from, int till, uint8_t* copyLocation, bool erase) {
+	int count = size();
+	for (int checked = 0; checked < count; checked++) {
+	int i = (_firstInserted + checked) % _capacity;
+	uint8_t* element = _data + i * _elementSize;
+	if (memcmp(element + from, sequence, size_t(till - from)) != 0)
+		continue;
+	if (copyLocation)
+		memcpy(copyLocation, element, size_t(_elementSize));
+	if (erase) {
+		// The gap is filled by the first element
+		if (i != _firstInserted)
+			memcpy(element, _data + _firstInserted * _elementSize, size_t(_elementSize));
+		popFront();
 	}
-	if (matches) {
-		if (copyLocation) {
-			for (int j = 0; j < _elementSize; j++)
-				copyLocation[j] = _data[i * _elementSize + j];
-			}
-			if (erase) {
-				if (_firstInserted != _lastInserted) {
-					for (int j = 0; j < _elementSize; j++)
-					copyLocation[i * _elementSize + j] = _data[_firstInserted * _elementSize + j];
-				}
-				popFront();
-			}
-			return true;
-		}
+	return true;
 	}
 	return false;
 }
 
+int CircularBufferImpl::firstIndex() const {
+	return _firstInserted;
+}
+
+#if defined(__AVX2__)
+#define HAS_VECTORS
+using Vector = __m256i;
+constexpr int BITS_PER_BYTE = 1; // In the mask of equal bytes
+
+static Vector load(const uint8_t* at) {
+	return _mm256_loadu_si256(reinterpret_cast<const Vector*>(at));
+}
+
+template <typename Key>
+static Vector broadcast(Key key) {
+	if constexpr (sizeof(Key) == 1)
+		return _mm256_set1_epi8(key);
+	else if constexpr (sizeof(Key) == 2)
+		return _mm256_set1_epi16(key);
+	else if constexpr (sizeof(Key) == 4)
+		return _mm256_set1_epi32(key);
+	else
+		return _mm256_set1_epi64x(key);
+}
+
+// Bits of all bytes of equal keys are set
+template <typename Key>
+static uint64_t equalKeys(Vector keys, Vector wanted) {
+	if constexpr (sizeof(Key) == 1)
+		return uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(keys, wanted)));
+	else if constexpr (sizeof(Key) == 2)
+		return uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi16(keys, wanted)));
+	else if constexpr (sizeof(Key) == 4)
+		return uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi32(keys, wanted)));
+	else
+		return uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi64(keys, wanted)));
+}
+#elif defined(__SSE2__)
+#define HAS_VECTORS
+using Vector = __m128i;
+constexpr int BITS_PER_BYTE = 1;
+
+static Vector load(const uint8_t* at) {
+	return _mm_loadu_si128(reinterpret_cast<const Vector*>(at));
+}
+
+template <typename Key>
+static Vector broadcast(Key key) {
+	if constexpr (sizeof(Key) == 1)
+		return _mm_set1_epi8(key);
+	else if constexpr (sizeof(Key) == 2)
+		return _mm_set1_epi16(key);
+	else if constexpr (sizeof(Key) == 4)
+		return _mm_set1_epi32(key);
+	else
+		return _mm_set1_epi64x(key);
+}
+
+template <typename Key>
+static uint64_t equalKeys(Vector keys, Vector wanted) {
+	if constexpr (sizeof(Key) == 1)
+		return uint32_t(_mm_movemask_epi8(_mm_cmpeq_epi8(keys, wanted)));
+	else if constexpr (sizeof(Key) == 2)
+		return uint32_t(_mm_movemask_epi8(_mm_cmpeq_epi16(keys, wanted)));
+	else if constexpr (sizeof(Key) == 4)
+		return uint32_t(_mm_movemask_epi8(_mm_cmpeq_epi32(keys, wanted)));
+	else {
+		// No 64-bit comparison in SSE2, both halves must be equal
+		Vector halves = _mm_cmpeq_epi32(keys, wanted);
+		return uint32_t(_mm_movemask_epi8(_mm_and_si128(halves, _mm_shuffle_epi32(halves, _MM_SHUFFLE(2, 3, 0, 1)))));
+	}
+}
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#define HAS_VECTORS
+using Vector = uint8x16_t;
+constexpr int BITS_PER_BYTE = 4;
+
+static Vector load(const uint8_t* at) {
+	return vld1q_u8(at);
+}
+
+template <typename Key>
+static Vector broadcast(Key key) {
+	if constexpr (sizeof(Key) == 1)
+		return vdupq_n_u8(key);
+	else if constexpr (sizeof(Key) == 2)
+		return vreinterpretq_u8_u16(vdupq_n_u16(key));
+	else if constexpr (sizeof(Key) == 4)
+		return vreinterpretq_u8_u32(vdupq_n_u32(key));
+	else
+		return vreinterpretq_u8_u64(vdupq_n_u64(key));
+}
+
+template <typename Key>
+static uint64_t equalKeys(Vector keys, Vector wanted) {
+	Vector equal;
+	if constexpr (sizeof(Key) == 1)
+		equal = vceqq_u8(keys, wanted);
+	else if constexpr (sizeof(Key) == 2)
+		equal = vreinterpretq_u8_u16(vceqq_u16(vreinterpretq_u16_u8(keys), vreinterpretq_u16_u8(wanted)));
+	else if constexpr (sizeof(Key) == 4)
+		equal = vreinterpretq_u8_u32(vceqq_u32(vreinterpretq_u32_u8(keys), vreinterpretq_u32_u8(wanted)));
+	else
+		equal = vreinterpretq_u8_u64(vceqq_u64(vreinterpretq_u64_u8(keys), vreinterpretq_u64_u8(wanted)));
+	// No movemask in NEON, narrowing leaves 4 bits per byte
+	return vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(equal), 4)), 0);
+}
+#endif
+
+template <typename Key>
+static int findKeyOfType(const uint8_t* keys, int count, const uint8_t* key) {
+	Key wanted;
+	memcpy(&wanted, key, sizeof(Key));
+	int i = 0;
+#ifdef HAS_VECTORS
+	constexpr int PER_VECTOR = sizeof(Vector) / sizeof(Key);
+	Vector repeated = broadcast<Key>(wanted);
+	for (; i + PER_VECTOR <= count; i += PER_VECTOR) {
+		uint64_t equal = equalKeys<Key>(load(keys + i * sizeof(Key)), repeated);
+		if (equal)
+			return i + __builtin_ctzll(equal) / (BITS_PER_BYTE * sizeof(Key));
+	}
+#endif
+	for (; i < count; i++) {
+		Key compared;
+		memcpy(&compared, keys + i * sizeof(Key), sizeof(Key));
+		if (compared == wanted)
+			return i;
+	}
+	return -1;
+}
+
+int findKey(const uint8_t* keys, int count, int keyWidth, const uint8_t* key) {
+	switch (keyWidth) {
+	case 1:
+		return findKeyOfType<uint8_t>(keys, count, key);
+	case 2:
+		return findKeyOfType<uint16_t>(keys, count, key);
+	case 4:
+		return findKeyOfType<uint32_t>(keys, count, key);
+	case 8:
+		return findKeyOfType<uint64_t>(keys, count, key);
+	}
+	for (int i = 0; i < count; i++)
+		if (memcmp(keys + i * keyWidth, key, size_t(keyWidth)) == 0)
+			return i;
+	return -1;
+}
+
 bool CircularBufferImpl::full() const {
-	return ((_lastInserted + 1) % _capacity != _firstInserted);
+	return size() == _capacity;
 }
 
 int CircularBufferImpl::size() const {
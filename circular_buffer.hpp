@@ -1,7 +1,16 @@
 #ifndef CIRCULAR_BUFFER_H
 #define CIRCULAR_BUFFER_H
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <algorithm>
 #include <array>
 #include <optional>
+#include <iterator>
+#include <type_traits>
+#if __has_include(<span>)
+#include <span>
+#endif
 
 class CircularBufferImpl {
 	uint8_t* _data;
@@ -13,14 +22,37 @@ class CircularBufferImpl {
 public:
 	CircularBufferImpl(uint8_t* data, short int capacity, short int elementSize);
 
-	void pushBack(const void* data);
+	// Returns false if full
+	bool pushBack(const void* data);
+
+	// Removes the first element if full
+	void pushBackOverwriting(const void* data);
 
 	void* front() const;
 
 	void popFront();
 
+	void* back() const;
+
+	void popBack();
+
+	// Copies as many elements as fit, returns how many
+	int pushBackBulk(const void* data, int count);
+
+	// Copies up to count elements out and removes them, returns how many
+	int popFrontBulk(void* into, int count);
+
+	// Removes count elements from the front without copying them
+	void commit(int count);
+
+	// How many elements are readable from front() before the buffer wraps
+	int contiguousSize() const;
+
 	bool find(uint8_t* sequence, int from, int till, uint8_t* copyLocation, bool erase);
 
+	// Position of front() in the array
+	int firstIndex() const;
+
 	bool full() const;
 
 	int size() const;
@@ -28,79 +60,417 @@ public:
 	bool empty() const;
 };
 
-template <typename T, int CAPACITY = 8>
-class CircularQueue : private CircularBufferImpl {
+// Returns the position of key among count keys of keyWidth bytes each, or -1, uses vector instructions if available
+int findKey(const uint8_t* keys, int count, int keyWidth, const uint8_t* key);
+
+// The same as CircularBufferImpl, but everything is known at compile time, so it's inlined for each type and capacity
+template <int CAPACITY, int ELEMENT_SIZE>
+class InlineCircularBufferImpl {
+	static_assert(CAPACITY > 0, "Capacity must be positive");
+	constexpr static bool POWER_OF_TWO = (CAPACITY & (CAPACITY - 1)) == 0;
+	uint8_t* _data;
+	uint32_t _first = 0;
+	uint32_t _size = 0;
+
+	// Index must be below 2 * CAPACITY
+	constexpr static uint32_t wrap(uint32_t index) {
+		if constexpr (POWER_OF_TWO)
+			return index & (CAPACITY - 1);
+		else
+			return index >= uint32_t(CAPACITY) ? index - CAPACITY : index;
+	}
+	uint8_t* at(uint32_t index) const {
+		return _data + size_t(index) * ELEMENT_SIZE;
+	}
+
+public:
+	InlineCircularBufferImpl(uint8_t* data, int, int) : _data(data) {}
+
+	bool pushBack(const void* data) {
+		if (_size == CAPACITY)
+			return false;
+		memcpy(at(wrap(_first + _size)), data, ELEMENT_SIZE);
+		_size++;
+		return true;
+	}
+
+	void pushBackOverwriting(const void* data) {
+		memcpy(at(wrap(_first + _size)), data, ELEMENT_SIZE);
+		if (_size == CAPACITY)
+			_first = wrap(_first + 1);
+		else
+			_size++;
+	}
+
+	void* front() const {
+		return at(_first);
+	}
+
+	void popFront() {
+		_first = wrap(_first + 1);
+		_size--;
+	}
+
+	void* back() const {
+		return at(wrap(_first + _size - 1));
+	}
+
+	void popBack() {
+		_size--;
+	}
+
+	int pushBackBulk(const void* data, int count) {
+		uint32_t added = std::min<uint32_t>(count, CAPACITY - _size);
+		uint32_t start = wrap(_first + _size);
+		uint32_t beforeWrap = std::min<uint32_t>(added, CAPACITY - start);
+		memcpy(at(start), data, size_t(beforeWrap) * ELEMENT_SIZE);
+		memcpy(_data, static_cast<const uint8_t*>(data) + size_t(beforeWrap) * ELEMENT_SIZE, size_t(added - beforeWrap) * ELEMENT_SIZE);
+		_size += added;
+		return added;
+	}
+
+	int popFrontBulk(void* into, int count) {
+		uint32_t removed = std::min<uint32_t>(count, _size);
+		uint32_t beforeWrap = std::min<uint32_t>(removed, CAPACITY - _first);
+		memcpy(into, at(_first), size_t(beforeWrap) * ELEMENT_SIZE);
+		memcpy(static_cast<uint8_t*>(into) + size_t(beforeWrap) * ELEMENT_SIZE, _data, size_t(removed - beforeWrap) * ELEMENT_SIZE);
+		commit(removed);
+		return removed;
+	}
+
+	void commit(int count) {
+		uint32_t removed = std::min<uint32_t>(count, _size);
+		_first = wrap(_first + removed);
+		_size -= removed;
+	}
+
+	int contiguousSize() const {
+		return std::min<uint32_t>(_size, CAPACITY - _first);
+	}
+
+	int firstIndex() const {
+		return _first;
+	}
+
+	bool find(uint8_t* sequence, int from, int till, uint8_t* copyLocation, bool erase) {
+		for (uint32_t i = 0; i < _size; i++) {
+			uint8_t* element = at(wrap(_first + i));
+			if (memcmp(element + from, sequence, till - from) != 0)
+				continue;
+			if (copyLocation)
+				memcpy(copyLocation, element, ELEMENT_SIZE);
+			if (erase) {
+				if (i != 0)
+					memcpy(element, front(), ELEMENT_SIZE);
+				popFront();
+			}
+			return true;
+		}
+		return false;
+	}
+
+	bool full() const {
+		return _size == CAPACITY;
+	}
+
+	int size() const {
+		return _size;
+	}
+
+	bool empty() const {
+		return _size == 0;
+	}
+};
+
+// Selects the type-erased CircularBufferImpl, one copy of the code serves all types and capacities, limited to 32767 elements
+struct CompactEngine {
+	template <int CAPACITY, int ELEMENT_SIZE>
+	using Impl = CircularBufferImpl;
+};
+
+// Selects InlineCircularBufferImpl, faster and without size limits, but generated again for every type and capacity
+struct InlineEngine {
+	template <int CAPACITY, int ELEMENT_SIZE>
+	using Impl = InlineCircularBufferImpl<CAPACITY, ELEMENT_SIZE>;
+};
+
+// Random access iterator over the elements of a façade, from the oldest to the newest
+template <typename T>
+class CircularIterator {
+	T* _data = nullptr;
+	int _first = 0; // Index of the oldest element in the array
+	int _capacity = 0;
+	int _offset = 0; // From the oldest element
+
+public:
+	using iterator_category = std::random_access_iterator_tag;
+	using value_type = std::remove_const_t<T>;
+	using difference_type = std::ptrdiff_t;
+	using pointer = T*;
+	using reference = T&;
+
+	CircularIterator() = default;
+	CircularIterator(T* data, int first, int capacity, int offset) : _data(data), _first(first), _capacity(capacity), _offset(offset) {}
+	operator CircularIterator<const T>() const {
+		return {_data, _first, _capacity, _offset};
+	}
+
+	reference operator*() const {
+		int index = _first + _offset;
+		if (index >= _capacity)
+			index -= _capacity;
+		return _data[index];
+	}
+	pointer operator->() const {
+		return &**this;
+	}
+	reference operator[](difference_type moved) const {
+		return *(*this + moved);
+	}
+
+	CircularIterator& operator++() {
+		_offset++;
+		return *this;
+	}
+	CircularIterator operator++(int) {
+		CircularIterator previous = *this;
+		_offset++;
+		return previous;
+	}
+	CircularIterator& operator--() {
+		_offset--;
+		return *this;
+	}
+	CircularIterator operator--(int) {
+		CircularIterator previous = *this;
+		_offset--;
+		return previous;
+	}
+	CircularIterator& operator+=(difference_type moved) {
+		_offset += int(moved);
+		return *this;
+	}
+	CircularIterator& operator-=(difference_type moved) {
+		_offset -= int(moved);
+		return *this;
+	}
+	CircularIterator operator+(difference_type moved) const {
+		return CircularIterator(*this) += moved;
+	}
+	friend CircularIterator operator+(difference_type moved, const CircularIterator& iterator) {
+		return iterator + moved;
+	}
+	CircularIterator operator-(difference_type moved) const {
+		return CircularIterator(*this) -= moved;
+	}
+	difference_type operator-(const CircularIterator& other) const {
+		return _offset - other._offset;
+	}
+
+	bool operator==(const CircularIterator& other) const {
+		return _offset == other._offset;
+	}
+	bool operator!=(const CircularIterator& other) const {
+		return _offset != other._offset;
+	}
+	bool operator<(const CircularIterator& other) const {
+		return _offset < other._offset;
+	}
+	bool operator>(const CircularIterator& other) const {
+		return _offset > other._offset;
+	}
+	bool operator<=(const CircularIterator& other) const {
+		return _offset <= other._offset;
+	}
+	bool operator>=(const CircularIterator& other) const {
+		return _offset >= other._offset;
+	}
+};
+
+template <typename T, int CAPACITY = 8, typename Engine = CompactEngine>
+class CircularQueue : private Engine::template Impl<CAPACITY, sizeof(T)> {
+	using Impl = typename Engine::template Impl<CAPACITY, sizeof(T)>;
+	static_assert(!std::is_same_v<Impl, CircularBufferImpl> || (CAPACITY <= INT16_MAX && sizeof(T) <= INT16_MAX), "Too large for CompactEngine, use InlineEngine");
 	std::array<T, CAPACITY> data;
 public:
-	CircularQueue() : CircularBufferImpl(reinterpret_cast<uint8_t*>(data.data()), CAPACITY, sizeof(T)) {
+	CircularQueue() : Impl(reinterpret_cast<uint8_t*>(&data), CAPACITY, sizeof(T)) {
+	}
+
+	// Returns false if it's full
+	bool pushBack(const T& element) {
+		return Impl::pushBack(&element);
 	}
 
-	void pushBack(const T& element) {
-		CircularBufferImpl::pushBack(&element);
+	// Removes the oldest element if it's full
+	void pushBackOverwriting(const T& element) {
+		Impl::pushBackOverwriting(&element);
 	}
 
 	T& front() const {
-		return *reinterpret_cast<T*>(CircularBufferImpl::front());
+		return *reinterpret_cast<T*>(Impl::front());
 	}
 
-	using CircularBufferImpl::popFront;
-	using CircularBufferImpl::full;
-	using CircularBufferImpl::size;
-	using CircularBufferImpl::empty;
+	T& back() const {
+		return *reinterpret_cast<T*>(Impl::back());
+	}
+
+	using Impl::popFront;
+	using Impl::popBack;
+	using Impl::commit;
+
+#ifdef __cpp_lib_span
+	// Returns how many were pushed, the rest didn't fit
+	int pushBack(std::span<const T> elements) {
+		return Impl::pushBackBulk(elements.data(), int(elements.size()));
+	}
+
+	// Fills the span from the front, returns how many were popped
+	int popFront(std::span<T> into) {
+		return Impl::popFrontBulk(into.data(), int(into.size()));
+	}
+
+	// Elements from the front that are next to each other in memory, remove them with commit() after reading
+	std::span<T> peekContiguous() const {
+		return {&front(), size_t(Impl::contiguousSize())};
+	}
+
+	// All elements in order, the second span is empty unless the content wraps around the end
+	std::array<std::span<T>, 2> peek() const {
+		std::span<T> first = peekContiguous();
+		return {first, {const_cast<T*>(data.data()), size_t(Impl::size()) - first.size()}};
+	}
+#endif
+
+	using iterator = CircularIterator<T>;
+	using const_iterator = CircularIterator<const T>;
+	iterator begin() {
+		return {data.data(), Impl::firstIndex(), CAPACITY, 0};
+	}
+	iterator end() {
+		return {data.data(), Impl::firstIndex(), CAPACITY, Impl::size()};
+	}
+	const_iterator begin() const {
+		return {data.data(), Impl::firstIndex(), CAPACITY, 0};
+	}
+	const_iterator end() const {
+		return {data.data(), Impl::firstIndex(), CAPACITY, Impl::size()};
+	}
+
+	using Impl::full;
+	using Impl::size;
+	using Impl::empty;
 	constexpr static int capacity = CAPACITY;
 };
 
-template <typename T, auto Index, int CAPACITY = 8>
-class CircularBuffer : private CircularBufferImpl {
+// A base, so that it takes no space without the key column
+template <typename Key, int CAPACITY, bool KEY_COLUMN>
+struct CircularBufferKeys {
+	std::array<Key, CAPACITY> keys;
+};
+
+template <typename Key, int CAPACITY>
+struct CircularBufferKeys<Key, CAPACITY, false> {};
+
+// If KEY_COLUMN is true, keys are also kept in a separate array, so that lookups can compare many of them at once
+template <typename T, auto Index, int CAPACITY = 8, typename Engine = CompactEngine, bool KEY_COLUMN = false>
+class CircularBuffer : private Engine::template Impl<CAPACITY, sizeof(T)>,
+		private CircularBufferKeys<std::decay_t<decltype(std::declval<T>().*Index)>, CAPACITY, KEY_COLUMN> {
+	using Impl = typename Engine::template Impl<CAPACITY, sizeof(T)>;
+	static_assert(!std::is_same_v<Impl, CircularBufferImpl> || (CAPACITY <= INT16_MAX && sizeof(T) <= INT16_MAX), "Too large for CompactEngine, use InlineEngine");
 	std::array<T, CAPACITY> data;
-	using indexType = decltype(std::declval<T>().*Index);
+	using indexType = std::decay_t<decltype(std::declval<T>().*Index)>;
 	static inline size_t indexOffset() {
 		return reinterpret_cast<size_t>(&(reinterpret_cast<T*>(0)->*Index));
 	}
 	static inline size_t indexEnd() {
 		return indexOffset() + sizeof(indexType);
 	}
+
+	int slotOf(const indexType& index) const {
+		const uint8_t* key = reinterpret_cast<const uint8_t*>(&index);
+		int first = Impl::firstIndex();
+		int contiguous = Impl::contiguousSize();
+		int found = findKey(reinterpret_cast<const uint8_t*>(this->keys.data() + first), contiguous, sizeof(indexType), key);
+		if (found >= 0)
+			return first + found;
+		return findKey(reinterpret_cast<const uint8_t*>(this->keys.data()), Impl::size() - contiguous, sizeof(indexType), key);
+	}
+
+	bool lookUp(indexType index, T* copyLocation, bool erase) {
+		if constexpr (!KEY_COLUMN) {
+			return Impl::find(reinterpret_cast<uint8_t*>(&index), indexOffset(), indexEnd(), reinterpret_cast<uint8_t*>(copyLocation), erase);
+		} else {
+			int slot = slotOf(index);
+			if (slot < 0)
+				return false;
+			if (copyLocation)
+				*copyLocation = data[slot];
+			if (erase) {
+				int first = Impl::firstIndex();
+				data[slot] = data[first];
+				this->keys[slot] = this->keys[first];
+				Impl::popFront();
+			}
+			return true;
+		}
+	}
+
 public:
-	CircularBuffer() : CircularBufferImpl(reinterpret_cast<uint8_t*>(&data), CAPACITY, sizeof(T)) {
+	CircularBuffer() : Impl(reinterpret_cast<uint8_t*>(&data), CAPACITY, sizeof(T)) {
 	}
 
-	void insert(const T& element) {
-		CircularBufferImpl::pushBack(&element);
+	// Returns false if it's full
+	bool insert(const T& element) {
+		if (!Impl::pushBack(&element))
+			return false;
+		if constexpr (KEY_COLUMN)
+			this->keys[(Impl::firstIndex() + Impl::size() - 1) % CAPACITY] = element.*Index;
+		return true;
 	}
 
 	bool has(indexType index) const {
-		return const_cast<CircularBuffer<T, Index, CAPACITY>*>(this)->find(reinterpret_cast<uint8_t*>(&index), indexOffset(), indexEnd(), nullptr, false);
+		return const_cast<CircularBuffer*>(this)->lookUp(index, nullptr, false);
 	}
 
 	T get(indexType index) {
 		T got;
-		find(reinterpret_cast<uint8_t*>(&index), indexOffset(), indexEnd(), reinterpret_cast<uint8_t*>(&got), false);
+		lookUp(index, &got, false);
 		return got;
 	}
 
 	std::optional<T> tryGet(indexType index) {
 		T got;
-		if (!find(reinterpret_cast<uint8_t*>(&index), indexOffset(), indexEnd(), reinterpret_cast<uint8_t*>(&got), false))
+		if (!lookUp(index, &got, false))
 			return std::nullopt;
 		return got;
 	}
 
 	T extract(indexType index) {
 		T got;
-		find(reinterpret_cast<uint8_t*>(&index), indexOffset(), indexEnd(), reinterpret_cast<uint8_t*>(&got), true);
+		lookUp(index, &got, true);
 		return got;
 	}
 
 	std::optional<T> tryExtract(indexType index) {
 		T got;
-		if (!find(reinterpret_cast<uint8_t*>(&index), indexOffset(), indexEnd(), reinterpret_cast<uint8_t*>(&got), true))
+		if (!lookUp(index, &got, true))
 		return std::nullopt;
 		return got;
 	}
 
-	using CircularBufferImpl::full;
-	using CircularBufferImpl::size;
-	using CircularBufferImpl::empty;
+	// Elements can't be modified through iterators, their keys could change
+	using iterator = CircularIterator<const T>;
+	using const_iterator = CircularIterator<const T>;
+	const_iterator begin() const {
+		return {data.data(), Impl::firstIndex(), CAPACITY, 0};
+	}
+	const_iterator end() const {
+		return {data.data(), Impl::firstIndex(), CAPACITY, Impl::size()};
+	}
+
+	using Impl::full;
+	using Impl::size;
+	using Impl::empty;
 	constexpr static int capacity = CAPACITY;
 };
 
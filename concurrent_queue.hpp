@@ -0,0 +1,183 @@
+#ifndef CONCURRENT_QUEUE_H
+#define CONCURRENT_QUEUE_H
+#include <cstdint>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <optional>
+#include <type_traits>
+
+// Separates variables written by different threads, so that they don't share a cache line
+constexpr int CACHE_LINE_SIZE = 64;
+
+// A FIFO queue for one thread that pushes and one thread that pops, without locking
+template <typename T, int CAPACITY = 8>
+class SpscQueue {
+	static_assert(std::is_trivially_copyable_v<T>, "Only trivially copyable types can be stored");
+	constexpr static int SLOTS = CAPACITY + 1; // One is always empty to tell full from empty
+
+	alignas(CACHE_LINE_SIZE) std::atomic<int> _head = 0; // Written only by the consumer
+	int _cachedTail = 0; // The consumer's last look at _tail
+	alignas(CACHE_LINE_SIZE) std::atomic<int> _tail = 0; // Written only by the producer
+	int _cachedHead = 0; // The producer's last look at _head
+	alignas(CACHE_LINE_SIZE) std::array<T, SLOTS> _data;
+
+	static int following(int index) {
+		return index + 1 == SLOTS ? 0 : index + 1;
+	}
+
+public:
+	SpscQueue() = default;
+	SpscQueue(const SpscQueue&) = delete;
+
+	// Producer only, returns false if it's full
+	bool pushBack(const T& element) {
+		int tail = _tail.load(std::memory_order_relaxed);
+		int next = following(tail);
+		if (next == _cachedHead) {
+			_cachedHead = _head.load(std::memory_order_acquire);
+			if (next == _cachedHead)
+				return false;
+		}
+		_data[tail] = element;
+		_tail.store(next, std::memory_order_release);
+		return true;
+	}
+
+	// Consumer only, must not be empty
+	T& front() {
+		return _data[_head.load(std::memory_order_relaxed)];
+	}
+
+	// Consumer only, must not be empty
+	void popFront() {
+		_head.store(following(_head.load(std::memory_order_relaxed)), std::memory_order_release);
+	}
+
+	// Consumer only
+	bool empty() {
+		int head = _head.load(std::memory_order_relaxed);
+		if (head != _cachedTail)
+			return false;
+		_cachedTail = _tail.load(std::memory_order_acquire);
+		return head == _cachedTail;
+	}
+
+	// Producer only
+	bool full() {
+		int next = following(_tail.load(std::memory_order_relaxed));
+		if (next != _cachedHead)
+			return false;
+		_cachedHead = _head.load(std::memory_order_acquire);
+		return next == _cachedHead;
+	}
+
+	// Any thread, may be outdated
+	int size() const {
+		int difference = _tail.load(std::memory_order_acquire) - _head.load(std::memory_order_acquire);
+		return difference < 0 ? difference + SLOTS : difference;
+	}
+	constexpr static int capacity = CAPACITY;
+};
+
+// A FIFO queue any number of threads can push to and pop from, every slot has a sequence number telling whose turn it is
+template <typename T, int CAPACITY = 8>
+class MpmcQueue {
+	static_assert(std::is_trivially_copyable_v<T>, "Only trivially copyable types can be stored");
+	static_assert(CAPACITY > 0 && (CAPACITY & (CAPACITY - 1)) == 0, "Capacity must be a power of two");
+
+	struct Slot {
+		// Equal to the position if it can be written, position + 1 if it can be read, never wraps
+		std::atomic<uint64_t> sequence;
+		T value;
+	};
+
+	alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> _pushPosition = 0;
+	alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> _popPosition = 0;
+	alignas(CACHE_LINE_SIZE) std::array<Slot, CAPACITY> _slots;
+
+	Slot& at(uint64_t position) {
+		return _slots[position & (CAPACITY - 1)];
+	}
+
+	// Reserves up to count consecutive slots whose sequence is position + offset, returns how many
+	int reserve(std::atomic<uint64_t>& next, uint64_t offset, int count, uint64_t& position) {
+		position = next.load(std::memory_order_relaxed);
+		while (true) {
+			int available = 0;
+			while (available < count) {
+				int64_t difference = at(position + available).sequence.load(std::memory_order_acquire) - (position + available + offset);
+				if (difference != 0) {
+					if (available == 0 && difference > 0) { // Someone else took it, try the next one
+						position = next.load(std::memory_order_relaxed);
+						continue;
+					}
+					break;
+				}
+				available++;
+			}
+			if (available == 0)
+				return 0; // Full or empty
+			if (next.compare_exchange_weak(position, position + available, std::memory_order_relaxed))
+				return available;
+		}
+	}
+
+public:
+	MpmcQueue() {
+		for (int i = 0; i < CAPACITY; i++)
+			_slots[i].sequence.store(i, std::memory_order_relaxed);
+	}
+	MpmcQueue(const MpmcQueue&) = delete;
+
+	// Returns false if it's full
+	bool tryPush(const T& element) {
+		return tryPushBulk(&element, 1) == 1;
+	}
+
+	std::optional<T> tryPop() {
+		T popped;
+		if (tryPopBulk(&popped, 1) == 0)
+			return std::nullopt;
+		return popped;
+	}
+
+	// Pushes as many as there is space for at once, returns how many
+	int tryPushBulk(const T* elements, int count) {
+		uint64_t position;
+		int reserved = reserve(_pushPosition, 0, count, position);
+		for (int i = 0; i < reserved; i++) {
+			Slot& slot = at(position + i);
+			slot.value = elements[i];
+			slot.sequence.store(position + i + 1, std::memory_order_release);
+		}
+		return reserved;
+	}
+
+	// Pops up to count elements into an array, returns how many
+	int tryPopBulk(T* into, int count) {
+		uint64_t position;
+		int reserved = reserve(_popPosition, 1, count, position);
+		for (int i = 0; i < reserved; i++) {
+			Slot& slot = at(position + i);
+			into[i] = slot.value;
+			slot.sequence.store(position + i + CAPACITY, std::memory_order_release);
+		}
+		return reserved;
+	}
+
+	// Any thread, may be outdated
+	int size() const {
+		int64_t difference = _pushPosition.load(std::memory_order_relaxed) - _popPosition.load(std::memory_order_relaxed);
+		return std::clamp<int64_t>(difference, 0, CAPACITY);
+	}
+	bool empty() const {
+		return size() == 0;
+	}
+	bool full() const {
+		return size() == CAPACITY;
+	}
+	constexpr static int capacity = CAPACITY;
+};
+
+#endif // CONCURRENT_QUEUE_H
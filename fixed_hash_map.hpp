@@ -0,0 +1,194 @@
+#ifndef FIXED_HASH_MAP_H
+#define FIXED_HASH_MAP_H
+#include <cstdint>
+#include <cstring>
+#include <array>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+// An unordered map of fixed size, elements are found by hashing their keys instead of searching
+// If EVICT_OLDEST is true, inserting into a full map removes the element that was inserted first
+template <typename T, auto Key, int CAPACITY = 8, bool EVICT_OLDEST = false>
+class FixedHashMap {
+	static_assert(std::is_trivially_copyable_v<T>, "Only trivially copyable types can be stored");
+	using keyType = std::decay_t<decltype(std::declval<T>().*Key)>;
+	using Index = std::conditional_t<(CAPACITY < INT16_MAX), int16_t, int32_t>;
+	constexpr static Index NONE = -1;
+	constexpr static int BUCKETS = [] {
+		int buckets = 1;
+		while (buckets < CAPACITY + CAPACITY / 4 + 1) // At most 80% full
+			buckets *= 2;
+		return buckets;
+	}();
+
+	// Open addressing with Robin Hood ordering, elements far from their place are not overtaken by those close to it
+	struct Bucket {
+		Index entry;
+		Index distance; // From the bucket the hash points to
+		uint32_t hash;
+	};
+
+	// Elements don't move, so that buckets can be moved cheaply, they are linked in the order of insertion
+	struct Entry {
+		T value;
+		Index older;
+		Index newer; // Next free entry if not used
+	};
+
+	std::array<Bucket, BUCKETS> _buckets;
+	std::array<Entry, CAPACITY> _entries;
+	Index _firstFree = NONE;
+	Index _neverUsed = 0;
+	Index _oldest = NONE;
+	Index _newest = NONE;
+	int _size = 0;
+
+	static uint32_t hashOf(const keyType& key) {
+		if constexpr (std::is_integral_v<keyType> && sizeof(keyType) <= sizeof(uint64_t)) {
+			return uint32_t((uint64_t(key) * 0x9e3779b97f4a7c15ull) >> 32);
+		} else {
+			uint32_t hash = 2166136261u; // FNV-1a
+			const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&key);
+			for (size_t i = 0; i < sizeof(keyType); i++)
+				hash = (hash ^ bytes[i]) * 16777619u;
+			return hash;
+		}
+	}
+
+	static bool sameKey(const T& element, const keyType& key) {
+		return memcmp(&(element.*Key), &key, sizeof(keyType)) == 0;
+	}
+
+	int findBucket(const keyType& key, uint32_t hash) const {
+		for (int distance = 0; distance < BUCKETS; distance++) {
+			const Bucket& bucket = _buckets[(hash + distance) & (BUCKETS - 1)];
+			// If it was here, it would have overtaken elements closer to their places
+			if (bucket.entry == NONE || bucket.distance < distance)
+				return -1;
+			if (bucket.hash == hash && sameKey(_entries[bucket.entry].value, key))
+				return (hash + distance) & (BUCKETS - 1);
+		}
+		return -1;
+	}
+
+	// Backward shift, following elements move closer to their places, so that no tombstone is needed
+	void removeBucket(int removed) {
+		int next = (removed + 1) & (BUCKETS - 1);
+		while (_buckets[next].entry != NONE && _buckets[next].distance > 0) {
+			_buckets[removed] = _buckets[next];
+			_buckets[removed].distance--;
+			removed = next;
+			next = (next + 1) & (BUCKETS - 1);
+		}
+		_buckets[removed].entry = NONE;
+	}
+
+	void removeEntry(Index removed) {
+		Entry& entry = _entries[removed];
+		(entry.older == NONE ? _oldest : _entries[entry.older].newer) = entry.newer;
+		(entry.newer == NONE ? _newest : _entries[entry.newer].older) = entry.older;
+		entry.newer = _firstFree;
+		_firstFree = removed;
+		_size--;
+	}
+
+	bool lookUp(const keyType& key, T* copyLocation, bool erase) {
+		int found = findBucket(key, hashOf(key));
+		if (found < 0)
+			return false;
+		Index entry = _buckets[found].entry;
+		if (copyLocation)
+			*copyLocation = _entries[entry].value;
+		if (erase) {
+			removeBucket(found);
+			removeEntry(entry);
+		}
+		return true;
+	}
+
+public:
+	FixedHashMap() {
+		for (Bucket& bucket : _buckets)
+			bucket.entry = NONE;
+	}
+
+	// Replaces an element with the same key, returns false if full and nothing could be evicted
+	bool insert(const T& element) {
+		uint32_t hash = hashOf(element.*Key);
+		int existing = findBucket(element.*Key, hash);
+		if (existing >= 0) {
+			_entries[_buckets[existing].entry].value = element;
+			return true;
+		}
+		if (_size == CAPACITY) {
+			if constexpr (!EVICT_OLDEST)
+				return false;
+			lookUp(_entries[_oldest].value.*Key, nullptr, true);
+		}
+
+		Index added = _firstFree;
+		if (added != NONE)
+			_firstFree = _entries[added].newer;
+		else
+			added = _neverUsed++;
+		_entries[added] = {element, _newest, NONE};
+		(_newest == NONE ? _oldest : _entries[_newest].newer) = added;
+		_newest = added;
+		_size++;
+
+		Bucket carried = {added, 0, hash};
+		for (int at = hash & (BUCKETS - 1); true; at = (at + 1) & (BUCKETS - 1), carried.distance++) {
+			Bucket& bucket = _buckets[at];
+			if (bucket.entry == NONE) {
+				bucket = carried;
+				return true;
+			}
+			if (bucket.distance < carried.distance)
+				std::swap(bucket, carried); // Takes the place of one that is closer to its place
+		}
+	}
+
+	bool has(keyType index) const {
+		return findBucket(index, hashOf(index)) >= 0;
+	}
+
+	T get(keyType index) {
+		T got = {};
+		lookUp(index, &got, false);
+		return got;
+	}
+
+	std::optional<T> tryGet(keyType index) {
+		T got;
+		if (!lookUp(index, &got, false))
+			return std::nullopt;
+		return got;
+	}
+
+	T extract(keyType index) {
+		T got = {};
+		lookUp(index, &got, true);
+		return got;
+	}
+
+	std::optional<T> tryExtract(keyType index) {
+		T got;
+		if (!lookUp(index, &got, true))
+			return std::nullopt;
+		return got;
+	}
+
+	bool full() const {
+		return _size == CAPACITY;
+	}
+	int size() const {
+		return _size;
+	}
+	bool empty() const {
+		return _size == 0;
+	}
+	constexpr static int capacity = CAPACITY;
+};
+
+#endif // FIXED_HASH_MAP_H
@@ -3,36 +3,181 @@
 #include <cstring>
 #include <utility>
 #include <cstdint>
+#include <cstddef>
+#include <new>
+#include <type_traits>
 
 template <typename T, size_t bufferSize = sizeof(void*) * 2>
 class Function;
 
+template <typename T, size_t bufferSize = sizeof(void*) * 2>
+class UniqueFunction;
+
+template <typename T>
+constexpr bool isFunction = false;
+template <typename T, size_t bufferSize>
+constexpr bool isFunction<Function<T, bufferSize>> = true;
+
+// Arguments that don't fit into registers are passed to the stored callable by reference, so that they are copied at most once
+template <typename T>
+constexpr bool passedInRegisters = std::is_reference_v<T> || std::is_scalar_v<T>
+		|| (std::is_trivially_copyable_v<T> && sizeof(T) <= sizeof(void*) * 2);
+template <typename T>
+using CallParameter = std::conditional_t<passedInRegisters<T>, T, std::conditional_t<std::is_trivially_copyable_v<T>, const T&, T>>;
+template <typename T>
+using ForwardedParameter = std::conditional_t<passedInRegisters<T>, T, std::conditional_t<std::is_trivially_copyable_v<T>, const T&, T&&>>;
+
+// Callables without state that can be created when needed don't have to be stored
+template <typename T>
+constexpr bool isStateless = std::is_empty_v<T> && std::is_default_constructible_v<T>;
+
+// Not initialised, so that creating a Function costs only copying the callable
+// Aligned like a pointer, aligning it more would make a Function of a small buffer twice as large
+template <size_t bufferSize>
+struct FunctionBuffer {
+	alignas(void*) uint8_t _data[bufferSize];
+	constexpr const void* data() const {
+		return _data;
+	}
+	void* data() {
+		return _data;
+	}
+};
+
+// Function<..., 0> is a single pointer and can hold only stateless callables
+template <>
+struct FunctionBuffer<0> {
+	constexpr const void* data() const {
+		return nullptr;
+	}
+};
+
 template <typename Returned, size_t bufferSize, typename... Args>
-class Function<Returned(Args...), bufferSize> {
-	Returned (*_called)(const void*, Args...) = nullptr;
-	uint8_t _data[bufferSize];
+class Function<Returned(Args...), bufferSize> : private FunctionBuffer<bufferSize> {
+	Returned (*_called)(const void*, ForwardedParameter<Args>...) = nullptr;
+
+	template <typename, size_t>
+	friend class Function;
+	template <typename, size_t>
+	friend class UniqueFunction;
 
 public:
-	Function() = default;
+	constexpr Function() = default;
 
 	template <typename T, decltype(Returned(std::declval<T>()(std::declval<Args>()...)))* = nullptr>
-	Function(const T& set) {
+	constexpr Function(const T& set) : _called([](const void* data, ForwardedParameter<Args>... args) -> Returned {
+				if constexpr (isStateless<T>)
+					return T()(static_cast<ForwardedParameter<Args>>(args)...);
+				else
+					return reinterpret_cast<const T*>(data)->operator()(static_cast<ForwardedParameter<Args>>(args)...);
+			}) {
 		static_assert(std::is_trivially_copyable_v<T>, "Only trivially copyable types can be captured.");
-		static_assert(sizeof(T) <= bufferSize, "Class too large to fit");
-		_called = [](const void* data, Args... args) {
-			return reinterpret_cast<const T*>(data)->operator()(args...);
-		};
-		new (_data) T(set);
+		if constexpr (!isStateless<T>) {
+			static_assert(sizeof(T) <= bufferSize, "Class too large to fit");
+			static_assert(alignof(T) <= alignof(void*), "Class too aligned to fit");
+			if constexpr (bufferSize > 0) // Otherwise only the assertion above should fail
+				new (this->data()) T(set);
+		} else if constexpr (bufferSize > 0) {
+#ifdef __cpp_lib_is_constant_evaluated
+			// Constants must not contain uninitialised bytes, constant Functions with a buffer need C++20
+			if (std::is_constant_evaluated())
+				for (uint8_t& byte : this->_data)
+					byte = 0;
+#endif
+		}
 	}
 
 	template <size_t otherBufferSize, std::enable_if_t<otherBufferSize != bufferSize>* = nullptr>
-	Function(const Function<Returned(Args...), otherBufferSize>& other) {
+	Function(const Function<Returned(Args...), otherBufferSize>& other) : _called(other._called) {
 		static_assert(otherBufferSize < bufferSize, "Cannot create a Function type from a larger Function type");
-		memcpy(this, &other, sizeof(Function<Returned(Args...), otherBufferSize>));
+		if constexpr (otherBufferSize > 0)
+			memcpy(this->data(), other.data(), otherBufferSize);
 	}
 
-	Returned operator()(Args... args) const {
-		return _called(reinterpret_cast<const void*>(_data), args...);
+	Returned operator()(CallParameter<Args>... args) const {
+		return _called(this->data(), static_cast<ForwardedParameter<Args>>(args)...);
+	}
+
+	constexpr operator bool() const {
+		return (_called != nullptr);
+	}
+
+	void reset() {
+		_called = nullptr;
+	}
+};
+
+// Like Function, but can contain callables that are not trivially copyable, it can be moved but not copied
+template <typename Returned, size_t bufferSize, typename... Args>
+class UniqueFunction<Returned(Args...), bufferSize> {
+	Returned (*_called)(const void*, ForwardedParameter<Args>...) = nullptr;
+	// Moves the callable to destination and destroys the source or only destroys it if destination is null
+	// Null if the callable is trivially copyable, so that it's moved by copying the bytes and needs no destruction
+	void (*_manager)(void* destination, void* source) = nullptr;
+	alignas(std::max_align_t) uint8_t _data[bufferSize];
+
+	void takeFrom(UniqueFunction& other) {
+		_called = other._called;
+		_manager = other._manager;
+		if (_manager)
+			_manager(_data, other._data);
+		else
+			memcpy(_data, other._data, bufferSize);
+		other._called = nullptr;
+		other._manager = nullptr;
+	}
+
+public:
+	UniqueFunction() = default;
+
+	template <typename T, typename Stored = std::decay_t<T>, std::enable_if_t<!std::is_same_v<Stored, UniqueFunction> && !isFunction<Stored>>* = nullptr,
+			decltype(Returned(std::declval<const Stored&>()(std::declval<Args>()...)))* = nullptr>
+	UniqueFunction(T&& set) {
+		static_assert(sizeof(Stored) <= bufferSize, "Class too large to fit");
+		static_assert(alignof(Stored) <= alignof(std::max_align_t), "Class too aligned to fit");
+		_called = [](const void* data, ForwardedParameter<Args>... args) -> Returned {
+			return reinterpret_cast<const Stored*>(data)->operator()(static_cast<ForwardedParameter<Args>>(args)...);
+		};
+		if constexpr (!std::is_trivially_copyable_v<Stored>) {
+			_manager = [](void* destination, void* source) {
+				Stored* moved = reinterpret_cast<Stored*>(source);
+				if (destination)
+					new (destination) Stored(std::move(*moved));
+				moved->~Stored();
+			};
+		}
+		new (_data) Stored(std::forward<T>(set));
+	}
+
+	template <size_t otherBufferSize>
+	UniqueFunction(const Function<Returned(Args...), otherBufferSize>& other) {
+		static_assert(otherBufferSize <= bufferSize, "Cannot create a UniqueFunction type from a larger Function type");
+		_called = other._called;
+		if constexpr (otherBufferSize > 0)
+			memcpy(_data, other.data(), otherBufferSize);
+	}
+
+	UniqueFunction(UniqueFunction&& other) {
+		takeFrom(other);
+	}
+
+	UniqueFunction& operator=(UniqueFunction&& other) {
+		if (&other != this) {
+			reset();
+			takeFrom(other);
+		}
+		return *this;
+	}
+
+	UniqueFunction(const UniqueFunction&) = delete;
+	UniqueFunction& operator=(const UniqueFunction&) = delete;
+
+	~UniqueFunction() {
+		reset();
+	}
+
+	Returned operator()(CallParameter<Args>... args) const {
+		return _called(reinterpret_cast<const void*>(_data), static_cast<ForwardedParameter<Args>>(args)...);
 	}
 
 	operator bool() const {
@@ -40,7 +185,53 @@ public:
 	}
 
 	void reset() {
+		if (_manager)
+			_manager(nullptr, _data);
 		_called = nullptr;
+		_manager = nullptr;
+	}
+};
+
+template <typename T>
+class FunctionRef;
+
+// Refers to a callable without copying it, so it has no size limit, but the callable must outlive it
+// Meant for callbacks passed to functions that don't keep them, it's as large as two pointers
+template <typename Returned, typename... Args>
+class FunctionRef<Returned(Args...)> {
+	union Target {
+		void* object;
+		void (*function)(); // Functions and function pointers are kept by value, there may be no object to refer to
+	};
+	Returned (*_called)(Target, ForwardedParameter<Args>...) = nullptr;
+	Target _target = {nullptr};
+
+public:
+	constexpr FunctionRef() = default;
+
+	template <typename T, typename Stored = std::remove_reference_t<T>, std::enable_if_t<!std::is_same_v<std::remove_cv_t<Stored>, FunctionRef>>* = nullptr,
+			decltype(Returned(std::declval<Stored&>()(std::declval<Args>()...)))* = nullptr>
+	FunctionRef(T&& callable) {
+		if constexpr (std::is_function_v<Stored> || std::is_pointer_v<std::decay_t<Stored>>) {
+			using Pointer = std::decay_t<Stored>;
+			_target.function = reinterpret_cast<void (*)()>(static_cast<Pointer>(callable));
+			_called = [](Target target, ForwardedParameter<Args>... args) -> Returned {
+				return reinterpret_cast<Pointer>(target.function)(static_cast<ForwardedParameter<Args>>(args)...);
+			};
+		} else {
+			_target.object = const_cast<void*>(static_cast<const void*>(&callable));
+			_called = [](Target target, ForwardedParameter<Args>... args) -> Returned {
+				return (*static_cast<Stored*>(target.object))(static_cast<ForwardedParameter<Args>>(args)...);
+			};
+		}
+	}
+
+	Returned operator()(CallParameter<Args>... args) const {
+		return _called(_target, static_cast<ForwardedParameter<Args>>(args)...);
+	}
+
+	constexpr operator bool() const {
+		return (_called != nullptr);
 	}
 };
 
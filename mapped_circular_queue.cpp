@@ -0,0 +1,141 @@
+#include "mapped_circular_queue.hpp"
+#include <cstring>
+#include <algorithm>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedCircularBufferImpl::MappedCircularBufferImpl(const char* path, int capacity, int elementSize, int syncPeriod) :
+	_syncPeriod(syncPeriod) {
+	// Only one process can create it, others open it and validate it, readers that don't know the capacity never create it
+	int file = capacity > 0 ? open(path, O_RDWR | O_CREAT | O_EXCL, 0644) : -1;
+	bool created = file >= 0;
+	if (!created)
+	file = open(path, O_RDWR);
+	if (file < 0)
+	return;
+	struct stat status;
+	if (!created && fstat(file, &status) != 0) {
+	close(file);
+	return;
+	}
+	size_t size = created ? MappedQueueHeader::DATA_OFFSET + size_t(capacity) * elementSize : size_t(status.st_size);
+	if (created && ftruncate(file, off_t(size)) != 0) {
+	close(file);
+	unlink(path);
+	return;
+	}
+	if (size < MappedQueueHeader::DATA_OFFSET) { // Still being created or not a queue
+	close(file);
+	return;
+	}
+	void* mapped = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+	close(file); // The mapping stays
+	if (mapped == MAP_FAILED)
+	return;
+
+	MappedQueueHeader* header = static_cast<MappedQueueHeader*>(mapped);
+	if (created) {
+	header->version = MappedQueueHeader::VERSION;
+	header->elementSize = elementSize;
+	header->capacity = capacity;
+	header->pushed.store(0, std::memory_order_relaxed);
+	header->popped.store(0, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	header->magic = MappedQueueHeader::MAGIC; // Last, so that a half initialised file is not recognised
+	msync(mapped, MappedQueueHeader::DATA_OFFSET, MS_SYNC);
+	} else if (header->magic != MappedQueueHeader::MAGIC || header->version != MappedQueueHeader::VERSION
+			|| header->elementSize != uint32_t(elementSize) || (capacity && header->capacity != uint32_t(capacity))
+			|| size != MappedQueueHeader::DATA_OFFSET + size_t(header->capacity) * elementSize) {
+	munmap(mapped, size);
+	return;
+	}
+	_header = header;
+	_data = static_cast<uint8_t*>(mapped) + MappedQueueHeader::DATA_OFFSET;
+	_mappedSize = size;
+}
+
+MappedCircularBufferImpl::~MappedCircularBufferImpl() {
+	if (_header)
+	munmap(_header, _mappedSize);
+}
+
+bool MappedCircularBufferImpl::isOpen() const {
+	return _header;
+}
+
+void* MappedCircularBufferImpl::reserveBack() {
+	if (full())
+	return nullptr;
+	uint64_t pushed = _header->pushed.load(std::memory_order_relaxed);
+	return _data + (pushed % _header->capacity) * _header->elementSize;
+}
+
+void* MappedCircularBufferImpl::reserveBackOverwriting() {
+	if (full())
+	_header->popped.fetch_add(1, std::memory_order_release);
+	return reserveBack();
+}
+
+void MappedCircularBufferImpl::commitBack() {
+	_header->pushed.fetch_add(1, std::memory_order_release);
+	pushed();
+}
+
+void MappedCircularBufferImpl::pushed() {
+	if (_syncPeriod > 0 && ++_unsynced >= _syncPeriod) {
+	msync(_header, _mappedSize, MS_ASYNC);
+	_unsynced = 0;
+	}
+}
+
+bool MappedCircularBufferImpl::pushBack(const void* data) {
+	void* reserved = reserveBack();
+	if (!reserved)
+	return false;
+	memcpy(reserved, data, _header->elementSize);
+	commitBack();
+	return true;
+}
+
+void MappedCircularBufferImpl::pushBackOverwriting(const void* data) {
+	memcpy(reserveBackOverwriting(), data, _header->elementSize);
+	commitBack();
+}
+
+void* MappedCircularBufferImpl::front() const {
+	return at(0);
+}
+
+void MappedCircularBufferImpl::popFront() {
+	_header->popped.fetch_add(1, std::memory_order_release);
+}
+
+void* MappedCircularBufferImpl::at(int index) const {
+	uint64_t position = _header->popped.load(std::memory_order_acquire) + index;
+	return _data + (position % _header->capacity) * _header->elementSize;
+}
+
+void MappedCircularBufferImpl::sync() {
+	msync(_header, _mappedSize, MS_SYNC);
+	_unsynced = 0;
+}
+
+int MappedCircularBufferImpl::size() const {
+	uint64_t popped = _header->popped.load(std::memory_order_acquire);
+	uint64_t pushed = _header->pushed.load(std::memory_order_acquire);
+	return int(std::min<uint64_t>(pushed - popped, _header->capacity)); // Other processes may push between the reads
+}
+
+bool MappedCircularBufferImpl::full() const {
+	return size() == int(_header->capacity);
+}
+
+bool MappedCircularBufferImpl::empty() const {
+	return size() == 0;
+}
+
+int MappedCircularBufferImpl::capacity() const {
+	return _header->capacity;
+}
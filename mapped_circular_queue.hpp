@@ -0,0 +1,125 @@
+#ifndef MAPPED_CIRCULAR_QUEUE_H
+#define MAPPED_CIRCULAR_QUEUE_H
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <type_traits>
+
+// Placed at the start of the file, the elements follow at offset DATA_OFFSET
+struct MappedQueueHeader {
+	constexpr static uint32_t MAGIC = 0x45555143; // "CQUE"
+	constexpr static uint32_t VERSION = 1;
+	constexpr static int DATA_OFFSET = 64;
+
+	uint32_t magic;
+	uint32_t version;
+	uint32_t elementSize;
+	uint32_t capacity;
+	std::atomic<uint64_t> pushed; // Counts all pushes ever, the position is this modulo capacity
+	std::atomic<uint64_t> popped;
+};
+static_assert(sizeof(MappedQueueHeader) <= MappedQueueHeader::DATA_OFFSET);
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "Other processes couldn't use the indexes");
+
+// Ring buffer in a memory mapped file, works with raw bytes, use MappedCircularQueue
+class MappedCircularBufferImpl {
+	MappedQueueHeader* _header = nullptr;
+	uint8_t* _data = nullptr;
+	size_t _mappedSize = 0;
+	int _syncPeriod;
+	int _unsynced = 0;
+
+	void pushed();
+
+public:
+	// Creates the file if it doesn't exist, fails if it has a different element size, capacity or version
+	// If capacity is 0, it only opens an existing file, with any capacity
+	// If another process is still creating the file, it fails
+	MappedCircularBufferImpl(const char* path, int capacity, int elementSize, int syncPeriod);
+	MappedCircularBufferImpl(const MappedCircularBufferImpl&) = delete;
+	~MappedCircularBufferImpl();
+
+	bool isOpen() const;
+
+	// Place where the next element can be written, nullptr if full
+	void* reserveBack();
+
+	// Place where the next element can be written, removes the first element if full
+	void* reserveBackOverwriting();
+
+	// Makes the element written into the reserved place visible
+	void commitBack();
+
+	bool pushBack(const void* data);
+
+	void pushBackOverwriting(const void* data);
+
+	void* front() const;
+
+	void popFront();
+
+	// Index from front()
+	void* at(int index) const;
+
+	// Writes the mapped memory into the file and waits until it's done
+	void sync();
+
+	int size() const;
+
+	bool full() const;
+
+	bool empty() const;
+
+	int capacity() const;
+};
+
+// A CircularQueue kept in a file, the content survives crashes and other processes can map the same file and read it
+// If syncPeriod is not zero, every syncPeriod pushes are flushed to the file without waiting
+template <typename T>
+class MappedCircularQueue : private MappedCircularBufferImpl {
+	static_assert(std::is_trivially_copyable_v<T>, "Only trivially copyable types can be stored");
+public:
+	MappedCircularQueue(const char* path, int capacity, int syncPeriod = 0) : MappedCircularBufferImpl(path, capacity, sizeof(T), syncPeriod) {
+	}
+
+	// Returns false if it's full
+	bool pushBack(const T& element) {
+		return MappedCircularBufferImpl::pushBack(&element);
+	}
+
+	// Removes the oldest element if it's full
+	void pushBackOverwriting(const T& element) {
+		MappedCircularBufferImpl::pushBackOverwriting(&element);
+	}
+
+	// Writing in place, the element must be filled and then published with commitBack()
+	T* reserveBack() {
+		return reinterpret_cast<T*>(MappedCircularBufferImpl::reserveBack());
+	}
+	T* reserveBackOverwriting() {
+		return reinterpret_cast<T*>(MappedCircularBufferImpl::reserveBackOverwriting());
+	}
+
+	T& front() const {
+		return *reinterpret_cast<T*>(MappedCircularBufferImpl::front());
+	}
+
+	T& operator[](int index) const {
+		return *reinterpret_cast<T*>(MappedCircularBufferImpl::at(index));
+	}
+
+	explicit operator bool() const {
+		return isOpen();
+	}
+
+	using MappedCircularBufferImpl::commitBack;
+	using MappedCircularBufferImpl::popFront;
+	using MappedCircularBufferImpl::sync;
+	using MappedCircularBufferImpl::isOpen;
+	using MappedCircularBufferImpl::full;
+	using MappedCircularBufferImpl::size;
+	using MappedCircularBufferImpl::empty;
+	using MappedCircularBufferImpl::capacity;
+};
+
+#endif // MAPPED_CIRCULAR_QUEUE_H
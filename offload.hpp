@@ -0,0 +1,126 @@
+#ifndef OFFLOAD_H
+#define OFFLOAD_H
+#include "scheduler.hpp"
+#include "concurrent_queue.hpp"
+#include <array>
+#include <optional>
+#include <semaphore>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+// Work given to a WorkerPool by a parked task, it unparks the task when it's done
+struct OffloadRequest : SchedulerBase::UnparkRequest {
+	SchedulerBase* scheduler = nullptr;
+	void (*run)(OffloadRequest* self) = nullptr;
+};
+
+// Threads that run computations for tasks, so that they don't stall the other tasks in their schedulers
+template <int THREADS = 4, int CAPACITY = 64>
+class WorkerPool {
+	MpmcQueue<OffloadRequest*, CAPACITY> _requests;
+	std::counting_semaphore<> _pending{0}; // Released once for every request and once for every thread when stopping
+	std::atomic<bool> _stopping = false;
+	std::array<std::thread, THREADS> _threads;
+
+	void work() {
+		while (true) {
+			_pending.acquire();
+			std::optional<OffloadRequest*> request;
+			while (!(request = _requests.tryPop())) {
+				if (_stopping)
+					return;
+				std::this_thread::yield(); // An earlier request is still being pushed
+			}
+			(*request)->run(*request);
+		}
+	}
+
+public:
+	WorkerPool() {
+		for (std::thread& thread : _threads)
+			thread = std::thread([this] { work(); });
+	}
+	WorkerPool(const WorkerPool&) = delete;
+	~WorkerPool() {
+		_stopping = true;
+		_pending.release(THREADS);
+		for (std::thread& thread : _threads)
+			thread.join();
+	}
+
+	// Returns false if it's full
+	bool post(OffloadRequest* request) {
+		if (_stopping || !_requests.tryPush(request))
+			return false;
+		_pending.release();
+		return true;
+	}
+};
+
+// The task is parked until a worker runs the function and the result is moved to it
+// If the pool is full, the function runs right away in the task
+template <typename Pool, typename Function>
+class Offloaded : OffloadRequest {
+	using Returned = std::invoke_result_t<Function&>;
+	using Result = std::conditional_t<std::is_void_v<Returned>, char, Returned>;
+
+	Pool& _pool;
+	Function _function;
+	std::optional<Result> _result;
+
+	void compute() {
+		if constexpr (std::is_void_v<Returned>)
+			_function();
+		else
+			_result.emplace(_function());
+	}
+
+public:
+	Offloaded(Pool& pool, Function&& function) : _pool(pool), _function(std::move(function)) {
+		run = [] (OffloadRequest* self) {
+			Offloaded* offloaded = static_cast<Offloaded*>(self);
+			offloaded->compute();
+			SchedulerBase* scheduler = offloaded->scheduler; // The awaiter may be gone as soon as the task is unparked
+			scheduler->unparkFromAnyThread(offloaded);
+			scheduler->releaseFromOtherThread();
+		};
+	}
+	Offloaded(const Offloaded&) = delete;
+
+	bool await_ready() {
+		return false;
+	}
+	bool await_suspend(std::coroutine_handle<> handle) {
+		scheduler = TaskBase::getScheduler();
+		task = scheduler->thisTaskIsParked(handle);
+		scheduler->holdForOtherThread(); // Destroying the scheduler destroys this, it has to wait until the worker is done
+		if (_pool.post(this))
+			return true;
+		scheduler->releaseFromOtherThread();
+		compute();
+		return false;
+	}
+	Returned await_resume() {
+		if constexpr (!std::is_void_v<Returned>)
+			return std::move(*_result);
+	}
+};
+
+template <int THREADS, int CAPACITY, typename Function>
+Offloaded<WorkerPool<THREADS, CAPACITY>, std::decay_t<Function>> offload(WorkerPool<THREADS, CAPACITY>& pool, Function&& function) {
+	return Offloaded<WorkerPool<THREADS, CAPACITY>, std::decay_t<Function>>(pool, std::decay_t<Function>(std::forward<Function>(function)));
+}
+
+inline WorkerPool<>& sharedWorkerPool() {
+	static WorkerPool<> shared;
+	return shared;
+}
+
+// Uses a pool shared by all schedulers
+template <typename Function>
+auto offload(Function&& function) {
+	return offload(sharedWorkerPool(), std::forward<Function>(function));
+}
+
+#endif // OFFLOAD_H
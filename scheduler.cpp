@@ -1,6 +1,6 @@
 #include "scheduler.hpp"
+#include <new>
 #include <chrono>
-#include <cstring>
 
 struct CoroutineContext {
 	SchedulerBase* instance = nullptr;
@@ -22,16 +22,16 @@ struct CoroutineContextScope {
 	}
 };
 
-uint32_t now() {
-	return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+uint32_t SteadyClock::now() {
+	return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
 }
 
-void PauserTill::await_suspend(std::coroutine_handle<>) {
-	schedulerInstance()->instance->thisTaskWillWait(timeMs);
+void PauserTill::await_suspend(std::coroutine_handle<> handle) {
+	schedulerInstance()->instance->thisTaskWillWait(timeMs, handle);
 }
 
-void Pauser::await_suspend(std::coroutine_handle<>) {
-	schedulerInstance()->instance->thisTaskIsNowLowPriority();
+void Pauser::await_suspend(std::coroutine_handle<> handle) {
+	schedulerInstance()->instance->thisTaskIsNowLowPriority(handle);
 }
 
 PauserTill waitForMs(uint32_t timeMs) {
@@ -49,37 +49,122 @@ SchedulerBase* TaskBase::getScheduler() {
 SchedulerBase::TaskEntry::TaskEntry() : flags(NO_FLAGS) {
 }
 
-SchedulerBase::TaskEntry::TaskEntry(Task&& task) : flags(DEFINED), timestamp(now()) {
-	new (&memory) Task(std::move(task));
+TaskPromiseBase* SchedulerBase::TaskEntry::promise() {
+	return std::launder(reinterpret_cast<Task*>(memory.data()))->_promise;
 }
 
-SchedulerBase::SchedulerBase(TaskEntry* entries, int entriesSize)
-		: _entries(entries), _entriesSize(entriesSize) {
-	memset(_entries, 0, sizeof(TaskEntry) * entriesSize);
+SchedulerBase::SchedulerBase(TaskEntry* entries, int16_t* deadlines, int entriesSize, uint32_t (*clock)(const void*), void (*advanceClock)(void*, uint32_t),
+		void* clockInstance) : _entries(entries), _deadlines(deadlines), _entriesSize(entriesSize), _clock(clock), _advanceClock(advanceClock),
+		_clockInstance(clockInstance), _time(clock(clockInstance)) {
+	for (int i = entriesSize - 1; i >= 0; i--) {
+		_entries[i].flags = TaskEntry::NO_FLAGS;
+		_entries[i].next = _firstFree;
+		_firstFree = i;
+	}
 }
 
 SchedulerBase::~SchedulerBase() {
+	while (_heldForOtherThreads.load(std::memory_order_acquire) > 0)
+		if (_sleep) // They still use it after their request could be taken
+			_sleep(_sleeper, 1);
 	for (int i = 0; i < _entriesSize; i++)
 		if (_entries[i].flags & TaskEntry::DEFINED) {
 			_entries[i].run(&_entries[i], this, true);
 		}
+	for (TaskPromiseBase* added : {_addedFromOtherThreads.exchange(nullptr), _waitingForSpace}) {
+		while (added) {
+			Task destroyed = Task(added);
+			added = added->nextAdded;
+		}
+	}
 }
 
 int SchedulerBase::currentCoroutine() {
 	return schedulerInstance()->currentTask;
 }
+
+uint32_t SchedulerBase::readClock() const {
+	return _clock(_clockInstance);
+}
+
+uint32_t SchedulerBase::now() {
+	CoroutineContext* context = schedulerInstance();
+	if (!context || context->instance != this)
+		_time = readClock(); // Inside a task, the time sampled when the round started is used
+	return _time;
+}
 	
 SchedulerBase::TaskEntry* SchedulerBase::addTaskHelper() {
-	for (int i = 0; i < _entriesSize; i++) {
-		if (!(_entries[i].flags & TaskEntry::DEFINED)) {
-			_entries[i].timestamp = now();
-			_entries[i].flags = TaskEntry::DEFINED;
-			_entries[i].depended = TaskEntry::NOT_DEPENDED;
-//			std::cout << "Registering task " << i << std::endl;
-			return &_entries[i];
-		}
+	if (_firstFree == TaskEntry::NO_FREE_ENTRY)
+		return nullptr;
+	TaskEntry& entry = _entries[_firstFree];
+	_firstFree = entry.next;
+	_taskCount++;
+	entry.timestamp = now();
+	entry.flags = TaskEntry::DEFINED;
+//	std::cout << "Registering task " << &entry - _entries << std::endl;
+	return &entry;
+}
+
+void SchedulerBase::removeTask(TaskEntry* entry) {
+	entry->flags = TaskEntry::NO_FLAGS;
+	entry->next = _firstFree;
+	_firstFree = entry - _entries;
+	_taskCount--;
+}
+
+constexpr int TOLERANCE = 0;
+
+namespace {
+bool isEarlier(uint32_t first, uint32_t second) {
+	return int32_t(first - second) < 0; // Survives overflows
+}
+}
+
+void SchedulerBase::enqueueDeadline(int index) {
+	siftDeadline(_deadlinesSize, index);
+	_deadlinesSize++;
+}
+
+void SchedulerBase::enqueueLowPriority(int index) {
+	_entries[index].next = TaskEntry::NO_LOW_PRIORITY;
+	if (_lastLowPriority == TaskEntry::NO_LOW_PRIORITY)
+		_firstLowPriority = index;
+	else
+		_entries[_lastLowPriority].next = index;
+	_lastLowPriority = index;
+}
+
+void SchedulerBase::siftDeadline(int position, int index) {
+	// Places index on the hole at position, moving it up or down the heap as needed
+	uint32_t timestamp = _entries[index].timestamp;
+	while (position > 0) {
+		int parent = (position - 1) / 2;
+		if (!isEarlier(timestamp, _entries[_deadlines[parent]].timestamp))
+			break;
+		_deadlines[position] = _deadlines[parent];
+		position = parent;
+	}
+	while (true) {
+		int child = position * 2 + 1;
+		if (child >= _deadlinesSize)
+			break;
+		if (child + 1 < _deadlinesSize && isEarlier(_entries[_deadlines[child + 1]].timestamp, _entries[_deadlines[child]].timestamp))
+			child++;
+		if (!isEarlier(_entries[_deadlines[child]].timestamp, timestamp))
+			break;
+		_deadlines[position] = _deadlines[child];
+		position = child;
 	}
-	return nullptr;
+	_deadlines[position] = index;
+}
+
+int SchedulerBase::takeEarliestDeadline() {
+	int taken = _deadlines[0];
+	_deadlinesSize--;
+	if (_deadlinesSize > 0)
+		siftDeadline(0, _deadlines[_deadlinesSize]);
+	return taken;
 }
 
 bool SchedulerBase::addTask(Task&& added) {
@@ -87,98 +172,249 @@ bool SchedulerBase::addTask(Task&& added) {
 	if (!place)
 		return false;
 	new (&place->memory) Task(std::move(added));
-	place->depended = TaskEntry::NOT_DEPENDED;
 	place->run = [] (TaskEntry* self, SchedulerBase* scheduler, bool justDestroy) {
-		Task& task = reinterpret_cast<Task&>(self->memory);
-		if (justDestroy || !task()) {
+		Task& task = *std::launder(reinterpret_cast<Task*>(self->memory.data()));
+		if (!justDestroy)
+			task._promise->resumed.resume();
+		if (justDestroy || !task) {
 //			std::cout << "Task finished" << std::endl;
-			self->flags = TaskEntry::NO_FLAGS;
 			task = Task();
+			scheduler->removeTask(self);
 		}
 	};
+	enqueueDeadline(place - _entries);
+	wake();
 	return true;
 }
 
+Task SchedulerBase::detachReadyTask() {
+	uint32_t timestamp = readClock() + TOLERANCE;
+	auto isReady = [&] (int position) {
+		return position < _deadlinesSize && !isEarlier(timestamp, _entries[_deadlines[position]].timestamp);
+	};
+	if (!isReady(0) || !(isReady(1) || isReady(2)))
+		return Task();
+	TaskEntry& entry = _entries[takeEarliestDeadline()];
+	Task detached = std::move(*std::launder(reinterpret_cast<Task*>(entry.memory.data())));
+	removeTask(&entry);
+	return detached;
+}
+
 int SchedulerBase::taskCount() const {
-	int result = 0;
-	for (int i = 0; i < _entriesSize; i++) {
-		if (_entries[i].flags & TaskEntry::DEFINED)
-			result++;
-	}
-	return result;
+	return _taskCount;
 }
 
-constexpr int TOLERANCE = 0;
-constexpr int STALE_AFTER = 3600000;
-
-void SchedulerBase::runATask(bool alsoLowPriority) {
-	uint32_t timestamp = now();
-	for (int lowPriority = 0; lowPriority < 2; lowPriority++) {
-		if (lowPriority && !alsoLowPriority) break;
-		
-		uint32_t highestPriority = 0;
-		constexpr int INVALID = -1;
-		int highestPriorityIndex = INVALID;
-		
-		for (int i = 0; i < _entriesSize; i++) {
-			if ((_entries[i].flags & TaskEntry::DEFINED) && !(_entries[i].flags & TaskEntry::AWAITING)) {
-				bool condition = false;
-				if (!(_entries[i].flags & TaskEntry::LOW_PRIORITY) && !lowPriority)
-					condition = _entries[i].timestamp - timestamp < TOLERANCE || timestamp - _entries[i].timestamp < STALE_AFTER;
-				else if (lowPriority && (_entries[i].flags & TaskEntry::LOW_PRIORITY))
-					condition = true;
-				
-				if (condition) {
-					uint32_t priority = 0;
-					if (!lowPriority)
-						priority = timestamp - _entries[i].timestamp + TOLERANCE;
-					else
-						priority = timestamp - _entries[i].timestamp;
-
-					if (priority > highestPriority) {
-						highestPriority = priority;
-						highestPriorityIndex = i;
-					}
-				}
-			}
-		}
-		
-		if (highestPriorityIndex != INVALID) {
-			if (!lowPriority)
-				_entries[highestPriorityIndex].timestamp = timestamp - STALE_AFTER - STALE_AFTER; // Will not be queued
-			else
-				_entries[highestPriorityIndex].timestamp = now();
-				
-			CoroutineContextScope keeper = {this, highestPriorityIndex};
-//			std::cout << "Task " << highestPriorityIndex << std::endl;
-			_entries[highestPriorityIndex].run(&_entries[highestPriorityIndex], this, false);
-//			std::cout << "Task done" << std::endl;
-			return;
-		}
+bool SchedulerBase::runATask(bool alsoLowPriority) {
+	if (hasRequestsFromOtherThreads())
+		takeRequestsFromOtherThreads();
+	_time = readClock(); // Before the work, so that it sees the current time too
+	bool ranWork = false;
+	if (_workQueue && _hasWork(_workQueue)) {
+		CoroutineContextScope keeper = {this};
+		ranWork = _runWork(_workQueue) > 0;
 	}
+	uint32_t timestamp = _time;
+	int chosen;
+	if (_deadlinesSize > 0 && !isEarlier(timestamp + TOLERANCE, _entries[_deadlines[0]].timestamp)) {
+		chosen = takeEarliestDeadline();
+	} else if (alsoLowPriority && _firstLowPriority != TaskEntry::NO_LOW_PRIORITY) {
+		chosen = _firstLowPriority;
+		_firstLowPriority = _entries[chosen].next;
+		if (_firstLowPriority == TaskEntry::NO_LOW_PRIORITY)
+			_lastLowPriority = TaskEntry::NO_LOW_PRIORITY;
+		_entries[chosen].timestamp = timestamp;
+	} else
+		return ranWork;
+
+	// The task is not queued anywhere while it runs, waiting or awaiting will queue it again
+	CoroutineContextScope keeper = {this, chosen};
+//	std::cout << "Task " << chosen << std::endl;
+	_entries[chosen].run(&_entries[chosen], this, false);
+//	std::cout << "Task done" << std::endl;
+	return true;
 }
 
 uint32_t SchedulerBase::timeLeft() const {
-	uint32_t earliest = std::numeric_limits<uint32_t>::max();
-	for (int i = 0; i < _entriesSize; i++) {
-		if ((_entries[i].flags & TaskEntry::DEFINED) && !(_entries[i].flags & TaskEntry::LOW_PRIORITY)) {
-			uint32_t timeLeft = _entries[i].timestamp - timeLeft;
-			if (timeLeft < STALE_AFTER)
-				if (timeLeft < earliest)
-					earliest = timeLeft;
-		}
+	if (hasRequestsFromOtherThreads())
+		return 0;
+	if (_firstLowPriority != TaskEntry::NO_LOW_PRIORITY)
+		return 0;
+	if (_deadlinesSize == 0)
+		return std::numeric_limits<uint32_t>::max();
+	uint32_t timestamp = readClock() + TOLERANCE;
+	uint32_t deadline = _entries[_deadlines[0]].timestamp;
+	if (!isEarlier(timestamp, deadline))
+		return 0;
+	return deadline - timestamp;
+}
+
+int SchedulerBase::runUntilIdle() {
+	int ran = 0;
+	while (runATask(false))
+		ran++;
+	return ran;
+}
+
+void SchedulerBase::runFor(uint32_t timeMs) {
+	uint32_t end = readClock() + timeMs;
+	while (true) {
+		bool ran = runATask(); // Some tasks may be ready all the time, it must stop anyway
+		uint32_t timestamp = readClock();
+		if (!isEarlier(timestamp, end))
+			return;
+		if (!ran)
+			sleepFor(std::min(timeLeft(), end - timestamp));
 	}
-	return earliest;
 }
 
-void SchedulerBase::thisTaskWillWait(uint32_t delay) {
+void SchedulerBase::sleepFor(uint32_t timeMs) {
+	if (_advanceClock)
+		_advanceClock(_clockInstance, timeMs);
+	else if (_sleep)
+		_sleep(_sleeper, timeMs);
+}
+
+void SchedulerBase::wake() {
+	if (_wakeSleeper)
+		_wakeSleeper(_sleeper);
+}
+
+void SchedulerBase::thisTaskWillWait(uint32_t delay, std::coroutine_handle<> resumed) {
 	int currentTask = schedulerInstance()->currentTask;
+	_entries[currentTask].promise()->resumed = resumed;
 	_entries[currentTask].timestamp = now() + delay;
-	_entries[currentTask].flags = decltype(TaskEntry::flags)(_entries[currentTask].flags ^ TaskEntry::LOW_PRIORITY);
+	enqueueDeadline(currentTask);
 }
 
-void SchedulerBase::thisTaskIsNowLowPriority() {
+void SchedulerBase::thisTaskIsNowLowPriority(std::coroutine_handle<> resumed) {
 	int currentTask = schedulerInstance()->currentTask;
+	_entries[currentTask].promise()->resumed = resumed;
 	_entries[currentTask].timestamp = now();
-	_entries[currentTask].flags = decltype(TaskEntry::flags)(_entries[currentTask].flags | TaskEntry::LOW_PRIORITY);
+	enqueueLowPriority(currentTask);
+}
+
+int SchedulerBase::thisTaskIsParked(std::coroutine_handle<> resumed) {
+	int currentTask = schedulerInstance()->currentTask;
+	_entries[currentTask].promise()->resumed = resumed;
+	return currentTask;
+}
+
+void SchedulerBase::unpark(int task) {
+	_entries[task].timestamp = now();
+	enqueueDeadline(task);
+}
+
+void SchedulerBase::unparkFromAnyThread(UnparkRequest* request) {
+	holdForOtherThread();
+	UnparkRequest* first = _unparkedFromOtherThreads.load(std::memory_order_relaxed);
+	do {
+		request->next = first;
+	} while (!_unparkedFromOtherThreads.compare_exchange_weak(first, request, std::memory_order_release, std::memory_order_relaxed));
+	wake();
+	releaseFromOtherThread();
+}
+
+void SchedulerBase::holdForOtherThread() {
+	_heldForOtherThreads.fetch_add(1, std::memory_order_relaxed);
+}
+
+void SchedulerBase::releaseFromOtherThread() {
+	_heldForOtherThreads.fetch_sub(1, std::memory_order_release);
+}
+
+void SchedulerBase::addTaskFromAnyThread(Task&& added) {
+	holdForOtherThread();
+	TaskPromiseBase* promise = static_cast<TaskPromiseBase*>(added.release());
+	TaskPromiseBase* first = _addedFromOtherThreads.load(std::memory_order_relaxed);
+	do {
+		promise->nextAdded = first;
+	} while (!_addedFromOtherThreads.compare_exchange_weak(first, promise, std::memory_order_release, std::memory_order_relaxed));
+	wake();
+	releaseFromOtherThread();
+}
+
+bool SchedulerBase::hasRequestsFromOtherThreads() const {
+	return _addedFromOtherThreads.load(std::memory_order_relaxed) || _unparkedFromOtherThreads.load(std::memory_order_relaxed)
+			|| (_waitingForSpace && _firstFree != TaskEntry::NO_FREE_ENTRY) || (_workQueue && _hasWork(_workQueue));
+}
+
+namespace {
+template <typename Node>
+Node* reverse(Node* first, Node* Node::*next) {
+	// The lock-free stacks have the newest request first
+	Node* reversed = nullptr;
+	while (first) {
+		Node* following = first->*next;
+		first->*next = reversed;
+		reversed = first;
+		first = following;
+	}
+	return reversed;
+}
+}
+
+void SchedulerBase::takeRequestsFromOtherThreads() {
+	UnparkRequest* unparked = reverse(_unparkedFromOtherThreads.exchange(nullptr, std::memory_order_acquire), &UnparkRequest::next);
+	while (unparked) {
+		UnparkRequest* next = unparked->next; // The request may disappear when the task runs
+		unpark(unparked->task);
+		unparked = next;
+	}
+
+	TaskPromiseBase* added = reverse(_addedFromOtherThreads.exchange(nullptr, std::memory_order_acquire), &TaskPromiseBase::nextAdded);
+	if (_waitingForSpace) { // Those that were added before go first
+		TaskPromiseBase* last = _waitingForSpace;
+		while (last->nextAdded)
+			last = last->nextAdded;
+		last->nextAdded = added;
+		added = _waitingForSpace;
+	}
+	while (added && _firstFree != TaskEntry::NO_FREE_ENTRY) {
+		TaskPromiseBase* next = added->nextAdded;
+		addTask(Task(added));
+		added = next;
+	}
+	_waitingForSpace = added;
+}
+
+bool Event::Awaiter::await_suspend(std::coroutine_handle<> handle) {
+	scheduler = TaskBase::getScheduler();
+	task = scheduler->thisTaskIsParked(handle);
+	void* state = event->_state.load();
+	while (true) {
+		if (!state) {
+			if (event->_state.compare_exchange_weak(state, static_cast<void*>(this)))
+				return true;
+		} else if (state == SIGNALLED) { // Got signalled in the meantime, continues without waiting
+			if (event->_state.compare_exchange_weak(state, nullptr))
+				return false;
+		} else if (state == WAKING_SIGNALLED) {
+			if (event->_state.compare_exchange_weak(state, WAKING))
+				return false;
+		} else
+			state = event->_state.load(); // The previous awaiter is being woken, it doesn't take long
+	}
+}
+
+void Event::signal() {
+	void* state = _state.load();
+	while (true) {
+		if (state == SIGNALLED || state == WAKING_SIGNALLED)
+			return;
+		if (!state) {
+			if (_state.compare_exchange_weak(state, SIGNALLED))
+				return;
+		} else if (state == WAKING) {
+			if (_state.compare_exchange_weak(state, WAKING_SIGNALLED))
+				return;
+		} else if (_state.compare_exchange_weak(state, WAKING)) {
+			// The awaiter's destructor waits until it's no longer WAKING, so the awaiter and its scheduler stay valid
+			Awaiter* awaiter = static_cast<Awaiter*>(state);
+			awaiter->scheduler->unparkFromAnyThread(awaiter);
+			void* waking = WAKING;
+			if (!_state.compare_exchange_strong(waking, nullptr))
+				_state.store(SIGNALLED);
+			return;
+		}
+	}
 }
@@ -7,6 +7,13 @@
 #include <optional>
 #include <iostream>
 #include <memory>
+#include <limits>
+#include <chrono>
+#include <atomic>
+#include <type_traits>
+#if __has_include(<semaphore>)
+#include <semaphore>
+#endif
 
 class PauserTill {
 	uint32_t timeMs;
@@ -33,92 +40,449 @@ Pauser waitSomeTime();
 
 struct SchedulerBase;
 
+// Clocks for the scheduler, they count milliseconds and are allowed to overflow
+struct SteadyClock {
+	static uint32_t now();
+};
+
+struct TickClock { // Meant to be ticked from a timer interrupt
+	static inline std::atomic<uint32_t> ticks = 0;
+	static uint32_t now() {
+		return ticks.load(std::memory_order_relaxed);
+	}
+	static void tick(uint32_t timeMs = 1) {
+		ticks.store(ticks.load(std::memory_order_relaxed) + timeMs, std::memory_order_relaxed);
+	}
+};
+
+// The scheduler jumps to the next deadline instead of sleeping, each scheduler has its own, see Scheduler::clock()
+// Time passes only while the scheduler is idle, tasks that are always ready keep it in place
+class SimulatedClock {
+	std::atomic<uint32_t> _time = 0;
+public:
+	uint32_t now() const {
+		return _time.load(std::memory_order_relaxed);
+	}
+	void advance(uint32_t timeMs) {
+		_time.fetch_add(timeMs, std::memory_order_relaxed);
+	}
+};
+
+// Sleepers block the scheduler's thread while it's idle, wake() ends the sleep early and can be called from any thread
+// Without one, runFor() keeps polling the clock, a sleeper for a microcontroller can wait for an interrupt instead
+struct NoSleeper {};
+
+#ifdef __cpp_lib_semaphore
+class ThreadSleeper {
+	enum State : uint8_t {
+		AWAKE,
+		SLEEPING,
+		WOKEN, // wake() was called, if it was while sleeping, it released the semaphore
+	};
+	std::atomic<State> _state = AWAKE;
+	std::binary_semaphore _wakeup{0};
+public:
+	void sleep(uint32_t timeMs) {
+		State awake = AWAKE;
+		if (!_state.compare_exchange_strong(awake, SLEEPING)) { // Woken since the last sleep, the scheduler may have missed why
+			_state = AWAKE;
+			return;
+		}
+		if (!_wakeup.try_acquire_for(std::chrono::milliseconds(timeMs)) && _state.exchange(AWAKE) == WOKEN)
+			_wakeup.acquire(); // Woken after the time ran out, the release must not be left for the next sleep
+		_state = AWAKE;
+	}
+	void wake() {
+		if (_state.exchange(WOKEN) == SLEEPING)
+			_wakeup.release();
+	}
+};
+
+// Schedulers on the steady clock run on an operating system and can block their thread
+template <typename Clock>
+using DefaultSleeper = std::conditional_t<std::is_same_v<Clock, SteadyClock>, ThreadSleeper, NoSleeper>;
+#else
+template <typename Clock>
+using DefaultSleeper = NoSleeper;
+#endif
+
 struct TaskBase {
 	static SchedulerBase* getScheduler();
 };
 
-struct Task : TaskBase {
-	struct promise_type {
-		auto get_return_object() {
-			return handle_type::from_promise(*this);
+struct AllocatorStatistics {
+	int inUse = 0;
+	int highWaterMark = 0; // The most elements that were in use at once
+	int heapFallbacks = 0; // How many times it had no space
+};
+
+template <int ElementCount = 16, int Size = 80, typename Tag = void> // Tag allows having separate spaces of the same size
+struct StaticAllocator {
+	class StaticAllocatingSpace {
+		alignas(void*) std::array<int8_t, ElementCount * Size> buffer;
+		void* firstFree = nullptr; // Each freed element holds a pointer to the next one
+		int neverUsed = 0; // Elements from this one on were never allocated, so they don't need to be linked
+		AllocatorStatistics statistics;
+		static_assert(Size % sizeof(void*) == 0, "ElementSize must be divisible by pointer size");
+		friend struct StaticAllocator;
+	};
+	static inline StaticAllocatingSpace _space;
+
+	StaticAllocator() = default;
+	template <int OtherElementCount, int OtherSize, typename OtherTag> constexpr StaticAllocator(const StaticAllocator<OtherElementCount, OtherSize, OtherTag>&) noexcept {}
+
+	static void* tryAllocate(size_t n) { // Returns nullptr if there's no space
+		if (n > Size)
+			return nullptr;
+		void* allocated = _space.firstFree;
+		if (allocated)
+			_space.firstFree = *reinterpret_cast<void**>(allocated);
+		else if (_space.neverUsed < ElementCount)
+			allocated = _space.buffer.data() + Size * _space.neverUsed++;
+		if (allocated) {
+			_space.statistics.inUse++;
+			_space.statistics.highWaterMark = std::max(_space.statistics.highWaterMark, _space.statistics.inUse);
 		}
-		auto initial_suspend() {
-			return std::suspend_always();
+		return allocated;
+	}
+
+	static void* allocate(size_t n) {
+		if (void* allocated = tryAllocate(n))
+			return allocated;
+		_space.statistics.heapFallbacks++;
+		return ::operator new(n);
+	}
+
+	static bool owns(const void* pointer) {
+		return pointer >= _space.buffer.data() && pointer < _space.buffer.data() + Size * ElementCount;
+	}
+
+	static void deallocate(void* pointer, size_t n) noexcept {
+		if (owns(pointer)) {
+			*reinterpret_cast<void**>(pointer) = _space.firstFree;
+			_space.firstFree = pointer;
+			_space.statistics.inUse--;
+		} else
+			::operator delete(pointer);
+	}
+
+	static AllocatorStatistics statistics() {
+		return _space.statistics;
+	}
+};
+
+template <int Count, int Size, typename Tag, int OtherCount, int OtherSize, typename OtherTag>
+bool operator==(const StaticAllocator<Count, Size, Tag>&, const StaticAllocator<OtherCount, OtherSize, OtherTag>&) { return true; }
+template <int Count, int Size, typename Tag, int OtherCount, int OtherSize, typename OtherTag>
+bool operator!=(const StaticAllocator<Count, Size, Tag>&, const StaticAllocator<OtherCount, OtherSize, OtherTag>&) { return false; }
+
+template <int Size, int ElementCount>
+struct SlabClass {
+	constexpr static int size = Size;
+	constexpr static int count = ElementCount;
+};
+
+struct SlabClassStatistics {
+	int size = 0;
+	int count = 0;
+	AllocatorStatistics usage;
+};
+
+// Allocates in the smallest class whose elements are large enough, if it's full, it tries larger ones, then the heap
+// Classes are given as SlabClass<size, count> from the smallest
+template <typename... Classes>
+struct SlabAllocator {
+	template <typename Class>
+	using Pool = StaticAllocator<Class::count, Class::size, SlabAllocator>;
+	static_assert(sizeof...(Classes) > 0, "At least one class is needed");
+	static_assert([] {
+		int sizes[] = { Classes::size... };
+		for (size_t i = 1; i < sizeof...(Classes); i++)
+			if (sizes[i] <= sizes[i - 1])
+				return false;
+		return true;
+	}(), "Classes must be ordered from the smallest");
+	static inline int _heapFallbacks = 0;
+
+	SlabAllocator() = default;
+
+	static void* allocate(size_t n) {
+		void* allocated = nullptr;
+		((allocated = Pool<Classes>::tryAllocate(n)) || ...);
+		if (allocated)
+			return allocated;
+		_heapFallbacks++;
+		return ::operator new(n);
+	}
+
+	static void deallocate(void* pointer, size_t n) noexcept {
+		bool owned = ((size_t(Classes::size) >= n && Pool<Classes>::owns(pointer) && (Pool<Classes>::deallocate(pointer, n), true)) || ...);
+		if (!owned)
+			::operator delete(pointer);
+	}
+
+	static std::array<SlabClassStatistics, sizeof...(Classes)> classStatistics() {
+		return { SlabClassStatistics{ Classes::size, Classes::count, Pool<Classes>::statistics() }... };
+	}
+
+	static AllocatorStatistics statistics() { // All classes together, the high water mark is the sum of the classes' ones
+		AllocatorStatistics total;
+		for (const SlabClassStatistics& added : classStatistics()) {
+			total.inUse += added.usage.inUse;
+			total.highWaterMark += added.usage.highWaterMark;
 		}
-		auto final_suspend() {
-			return std::suspend_always();
+		total.heapFallbacks = _heapFallbacks;
+		return total;
+	}
+};
+
+template <typename... Classes, typename... OtherClasses>
+bool operator==(const SlabAllocator<Classes...>&, const SlabAllocator<OtherClasses...>&) { return true; }
+template <typename... Classes, typename... OtherClasses>
+bool operator!=(const SlabAllocator<Classes...>&, const SlabAllocator<OtherClasses...>&) { return false; }
+
+// Like StaticAllocator, but can be used from multiple threads at once without locking
+template <int ElementCount = 16, int Size = 80, typename Tag = void>
+struct ConcurrentStaticAllocator {
+	class StaticAllocatingSpace {
+		constexpr static uint32_t NONE = std::numeric_limits<uint32_t>::max();
+		alignas(void*) std::array<int8_t, ElementCount * Size> buffer;
+		std::array<std::atomic<uint32_t>, ElementCount> next = {}; // Links of freed elements
+		std::atomic<uint64_t> firstFree = NONE; // Index of the first freed element, the upper half counts changes to avoid ABA
+		std::atomic<int> neverUsed = 0;
+		std::atomic<int> inUse = 0;
+		std::atomic<int> highWaterMark = 0;
+		std::atomic<int> heapFallbacks = 0;
+		static_assert(Size % sizeof(void*) == 0, "ElementSize must be divisible by pointer size");
+		friend struct ConcurrentStaticAllocator;
+	};
+	static inline StaticAllocatingSpace _space;
+
+	ConcurrentStaticAllocator() = default;
+	template <int OtherElementCount, int OtherSize, typename OtherTag> constexpr ConcurrentStaticAllocator(const ConcurrentStaticAllocator<OtherElementCount, OtherSize, OtherTag>&) noexcept {}
+
+	static void* allocate(size_t n) {
+		if (n <= Size) {
+			int index = -1;
+			uint64_t first = _space.firstFree.load(std::memory_order_acquire);
+			while (uint32_t(first) != StaticAllocatingSpace::NONE) {
+				uint64_t changed = ((first >> 32) + 1) << 32 | _space.next[uint32_t(first)].load(std::memory_order_relaxed);
+				if (_space.firstFree.compare_exchange_weak(first, changed, std::memory_order_acquire, std::memory_order_acquire)) {
+					index = uint32_t(first);
+					break;
+				}
+			}
+			if (index < 0 && _space.neverUsed.load(std::memory_order_relaxed) < ElementCount) {
+				index = _space.neverUsed.fetch_add(1, std::memory_order_relaxed);
+				if (index >= ElementCount)
+					index = -1;
+			}
+			if (index >= 0) {
+				int inUse = _space.inUse.fetch_add(1, std::memory_order_relaxed) + 1;
+				int highest = _space.highWaterMark.load(std::memory_order_relaxed);
+				while (highest < inUse && !_space.highWaterMark.compare_exchange_weak(highest, inUse, std::memory_order_relaxed));
+				return _space.buffer.data() + Size * index;
+			}
 		}
-		void return_void() {
+		_space.heapFallbacks.fetch_add(1, std::memory_order_relaxed);
+		return ::operator new(n);
+	}
+
+	static void deallocate(void* pointer, size_t n) noexcept {
+		if (pointer >= _space.buffer.data() && pointer < _space.buffer.data() + Size * ElementCount) {
+			uint32_t index = uint32_t((reinterpret_cast<int8_t*>(pointer) - _space.buffer.data()) / Size);
+			uint64_t first = _space.firstFree.load(std::memory_order_relaxed);
+			do {
+				_space.next[index].store(uint32_t(first), std::memory_order_relaxed);
+			} while (!_space.firstFree.compare_exchange_weak(first, ((first >> 32) + 1) << 32 | index, std::memory_order_release, std::memory_order_relaxed));
+			_space.inUse.fetch_sub(1, std::memory_order_relaxed);
+		} else
+			::operator delete(pointer);
+	}
+
+	static AllocatorStatistics statistics() {
+		return { _space.inUse.load(std::memory_order_relaxed), _space.highWaterMark.load(std::memory_order_relaxed),
+				_space.heapFallbacks.load(std::memory_order_relaxed) };
+	}
+};
+
+template <int Count, int Size, typename Tag, int OtherCount, int OtherSize, typename OtherTag>
+bool operator==(const ConcurrentStaticAllocator<Count, Size, Tag>&, const ConcurrentStaticAllocator<OtherCount, OtherSize, OtherTag>&) { return true; }
+template <int Count, int Size, typename Tag, int OtherCount, int OtherSize, typename OtherTag>
+bool operator!=(const ConcurrentStaticAllocator<Count, Size, Tag>&, const ConcurrentStaticAllocator<OtherCount, OtherSize, OtherTag>&) { return false; }
+
+struct FrameStatistics {
+	size_t largest = 0; // The largest coroutine frame allocated
+	int allocations = 0;
+};
+
+inline thread_local size_t* measuredFrameSize = nullptr; // Set only while frameSize() creates a coroutine
+
+// Size of the frame of the coroutine created by the function, which is created and destroyed without running
+// 0 if it's unknown, because the compiler placed the frame elsewhere
+template <typename Create>
+size_t frameSize(Create create) {
+	size_t measured = 0;
+	measuredFrameSize = &measured;
+	create();
+	measuredFrameSize = nullptr;
+	return measured;
+}
+
+// Allocates frames of coroutines whose promise inherits from this and keeps statistics about their sizes
+template <typename Allocator, typename Promise>
+struct AllocatedFrame {
+	static inline std::atomic<size_t> _largestFrame = 0;
+	static inline std::atomic<int> _allocations = 0;
+
+	static void* operator new(size_t size) {
+		size_t largest = _largestFrame.load(std::memory_order_relaxed);
+		while (largest < size && !_largestFrame.compare_exchange_weak(largest, size, std::memory_order_relaxed));
+		_allocations.fetch_add(1, std::memory_order_relaxed);
+		if (measuredFrameSize) { // The first frame allocated is the measured coroutine's
+			*measuredFrameSize = size;
+			measuredFrameSize = nullptr;
 		}
-		void unhandled_exception() {}
-	};
-	using handle_type = std::coroutine_handle<promise_type>;
+		if constexpr (requires { typename Allocator::value_type; }) { // Standard allocators count elements, not bytes
+			typename std::allocator_traits<Allocator>::template rebind_alloc<uint8_t> allocator;
+			return allocator.allocate(size);
+		} else {
+			Allocator allocator;
+			return allocator.allocate(size);
+		}
+	}
+
+	static void operator delete(void* pointer, size_t size) {
+		if constexpr (requires { typename Allocator::value_type; }) {
+			typename std::allocator_traits<Allocator>::template rebind_alloc<uint8_t> allocator;
+			allocator.deallocate(reinterpret_cast<uint8_t*>(pointer), size);
+		} else {
+			Allocator allocator;
+			allocator.deallocate(pointer, size);
+		}
+	}
+
+	static FrameStatistics frameStatistics() {
+		return { _largestFrame.load(std::memory_order_relaxed), _allocations.load(std::memory_order_relaxed) };
+	}
+};
+
+struct TaskPromiseBase {
+	std::coroutine_handle<> handle; // Of this coroutine
+	std::coroutine_handle<> resumed; // The innermost coroutine, where the task waits
+	TaskPromiseBase* nextAdded = nullptr; // Links tasks added from other threads
+	auto initial_suspend() {
+		return std::suspend_always();
+	}
+	auto final_suspend() noexcept {
+		return std::suspend_always();
+	}
+	void return_void() {
+	}
+	void unhandled_exception() {}
+};
+
+template <typename Allocator>
+struct TaskPromise : TaskPromiseBase, AllocatedFrame<Allocator, TaskPromise<Allocator>> {
+	TaskPromiseBase* get_return_object() {
+		handle = std::coroutine_handle<TaskPromise>::from_promise(*this);
+		resumed = handle;
+		return this;
+	}
+};
+
+// Owns a task with any allocator
+struct Task : TaskBase {
+	using promise_type = TaskPromise<std::allocator<void*>>;
 	Task() { }
-	Task(handle_type handle) : _handle(handle) { }
+	Task(TaskPromiseBase* promise) : _promise(promise) { }
 	Task& operator=(Task&& other) {
-		if (_handle)
-			_handle.destroy();
+		if (_promise)
+			_promise->handle.destroy();
 
-		_handle = std::move(other._handle);
-		other._handle = handle_type();
+		_promise = other._promise;
+		other._promise = nullptr;
 		return *this;
 	}
 	Task(const Task&) = delete;
-	Task(Task&& other) : _handle(std::move(other._handle)) {
-		other._handle = handle_type();
+	Task(Task&& other) : _promise(other._promise) {
+		other._promise = nullptr;
 	}
 	bool operator()() {
-		_handle.resume();
-		return !_handle.done();
+		_promise->handle.resume();
+		return !_promise->handle.done();
 	}
 	explicit operator bool() {
-		return !_handle.done();
+		return _promise && !_promise->handle.done();
 	}
 	~Task() {
-		if (_handle)
-			_handle.destroy();
+		if (_promise)
+			_promise->handle.destroy();
+	}
+	// For passing tasks between threads as a pointer
+	void* release() {
+		void* address = _promise;
+		_promise = nullptr;
+		return address;
+	}
+	static Task fromAddress(void* address) {
+		return Task(static_cast<TaskPromiseBase*>(address));
+	}
+	static FrameStatistics frameStatistics() {
+		return promise_type::frameStatistics();
+	}
+protected:
+	TaskPromiseBase* _promise = nullptr;
+	friend class SchedulerBase;
+};
+
+// Task whose frame is allocated with the allocator
+template <typename Allocator>
+struct BasicTask : Task {
+	using promise_type = TaskPromise<Allocator>;
+	BasicTask(TaskPromiseBase* promise) : Task(promise) { }
+	static FrameStatistics frameStatistics() {
+		return promise_type::frameStatistics();
 	}
-private:
-	handle_type _handle;
 };
 
 template <typename T, typename Allocator = std::allocator<void*>>
 struct Awaitable : private TaskBase {
-	struct promise_type {
-		T returned;
+	struct promise_type : AllocatedFrame<Allocator, promise_type> {
+		std::optional<T> returned; // Constructed in place, so that T needs no default constructor
+		std::coroutine_handle<> caller;
 		auto get_return_object() {
 			return handle_type::from_promise(*this);
 		}
 		auto initial_suspend() {
 			return std::suspend_always();
 		}
-		auto final_suspend() {
-			return std::suspend_always();
+		struct ReturnToCaller {
+			bool await_ready() noexcept {
+				return false;
+			}
+			std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> handle) noexcept {
+				if (handle.promise().caller)
+					return handle.promise().caller;
+				return std::noop_coroutine();
+			}
+			void await_resume() noexcept {}
+		};
+		auto final_suspend() noexcept {
+			return ReturnToCaller();
 		}
 		void return_value(const T& value) {
-			returned = value;
+			returned.emplace(value);
 		}
-		void unhandled_exception() {}
-		
-		void* operator new(size_t size)
-		{
-			Allocator allocator;
-			return allocator.allocate(size);
-		}
-
-		void operator delete(void* p)
-		{
-			Allocator allocator;
-			allocator.deallocate(reinterpret_cast<void**>(p), sizeof(promise_type));
-		}
-	
-		~promise_type() {
+		void return_value(T&& value) {
+			returned.emplace(std::move(value));
 		}
+		void unhandled_exception() {}
 	};
 	using handle_type = std::coroutine_handle<promise_type>;
 	Awaitable() { }
 	Awaitable(handle_type handle) : _handle(handle) { }
-	Awaitable& operator=(Task&& other) {
+	Awaitable& operator=(Awaitable&& other) {
 		if (_handle)
 			_handle.destroy();
 
@@ -141,12 +505,21 @@ struct Awaitable : private TaskBase {
 		if (_handle)
 			_handle.destroy();
 	}
+	static FrameStatistics frameStatistics() {
+		return promise_type::frameStatistics();
+	}
 	
-	bool await_ready();
-	void await_suspend(std::coroutine_handle<> handle) {
+	// The caller is suspended and the called coroutine runs right away on the same task,
+	// it resumes the caller when it's done
+	bool await_ready() {
+		return false;
+	}
+	std::coroutine_handle<> await_suspend(std::coroutine_handle<> caller) {
+		_handle.promise().caller = caller;
+		return _handle;
 	}
 	T await_resume() {
-		return _handle.promise().returned;
+		return std::move(*_handle.promise().returned);
 	}
 private:
 	handle_type _handle;
@@ -154,116 +527,228 @@ private:
 };
 
 class SchedulerBase {
+public:
+	// Has to stay valid until the scheduler takes it, it's meant to be a part of the parked task's frame
+	struct UnparkRequest {
+		int task = 0;
+		UnparkRequest* next = nullptr;
+	};
+
 protected:
+	// As large as before the deadline heap, the heap's indexes are the only space it adds per task
 	struct TaskEntry {
-		constexpr static int NOT_DEPENDED = -1;
+		constexpr static int NO_FREE_ENTRY = -1; // Ends the free list
+		constexpr static int NO_LOW_PRIORITY = -1; // Ends the low priority queue
 		enum : uint8_t {
 			NO_FLAGS = 0x0,
 			DEFINED = 0x1,
-			LOW_PRIORITY = 0x2,
-			AWAITING = 0x4,
 		} flags;
-		int16_t depended;
+		int16_t next; // Next entry in the free list or in the low priority queue
 		uint32_t timestamp;
-		alignas(void*) std::array<bool, std::max(sizeof(Task), sizeof(Awaitable<int>))> memory;
+		alignas(void*) std::array<bool, sizeof(Task)> memory;
 		void (*run)(TaskEntry* self, SchedulerBase* scheduler, bool justDestroy);
 		TaskEntry();
-		TaskEntry(Task&& task);
-		template <typename T>
-		TaskEntry(Awaitable<T>* awaitable);
+		TaskPromiseBase* promise(); // The innermost coroutine, where the task waits, is kept in it
 	};
 	TaskEntry* _entries;
+	int16_t* _deadlines; // Binary min-heap of indexes of entries that wait for a timestamp
 	int _entriesSize;
+	int _deadlinesSize = 0;
+	int _taskCount = 0;
+	int _firstFree = TaskEntry::NO_FREE_ENTRY;
+	int _firstLowPriority = TaskEntry::NO_LOW_PRIORITY;
+	int _lastLowPriority = TaskEntry::NO_LOW_PRIORITY;
+	uint32_t (*_clock)(const void* clock);
+	void (*_advanceClock)(void* clock, uint32_t timeMs); // Set only if the clock is simulated
+	void* _clockInstance; // Null if the clock has no state
+	void (*_sleep)(void* sleeper, uint32_t timeMs) = nullptr; // Null if it can only poll, see NoSleeper
+	void (*_wakeSleeper)(void* sleeper) = nullptr;
+	void* _sleeper = nullptr;
+	uint32_t _time; // Sampled once per round
+	std::atomic<TaskPromiseBase*> _addedFromOtherThreads = nullptr; // Linked in reverse order of adding
+	std::atomic<UnparkRequest*> _unparkedFromOtherThreads = nullptr;
+	std::atomic<int> _heldForOtherThreads = 0; // Those still running when it's destroyed must finish first
+	TaskPromiseBase* _waitingForSpace = nullptr; // Tasks from other threads that didn't fit yet, in order
+	void* _workQueue = nullptr; // Its work is run between tasks, see WorkQueue
+	int (*_runWork)(void* queue) = nullptr; // Runs a batch, returns how many were run
+	bool (*_hasWork)(const void* queue) = nullptr;
 	
-	SchedulerBase(TaskEntry* entries, int entriesSize);
+	SchedulerBase(TaskEntry* entries, int16_t* deadlines, int entriesSize, uint32_t (*clock)(const void*), void (*advanceClock)(void*, uint32_t),
+			void* clockInstance);
 	~SchedulerBase();
 	
 	TaskEntry* addTaskHelper();
+	void removeTask(TaskEntry* entry);
+	void enqueueDeadline(int index);
+	void enqueueLowPriority(int index);
+	void siftDeadline(int position, int index);
+	int takeEarliestDeadline();
 	static int currentCoroutine();
+	uint32_t readClock() const;
+	bool hasRequestsFromOtherThreads() const;
+	void takeRequestsFromOtherThreads();
 	
 public:
 	int taskCount() const;
-	void runATask(bool alsoLowPriority = true);
-	uint32_t timeLeft() const;
-	void thisTaskWillWait(uint32_t delay);
-	void thisTaskIsNowLowPriority();
+	uint32_t now(); // Inside tasks and work, the time sampled when the round started
+	bool runATask(bool alsoLowPriority = true); // Returns false if there was nothing to run
+	uint32_t timeLeft() const; // 0 if some task can run now, maximum if no task is waiting for anything
+	int runUntilIdle(); // Runs tasks until none has to run now, ignores low priority tasks, returns how many were run
+	void runFor(uint32_t timeMs); // Runs tasks and sleeps until the next one has to run, for the given time
+	template <typename Rep, typename Period>
+	void runFor(std::chrono::duration<Rep, Period> duration) {
+		runFor(std::chrono::duration_cast<std::chrono::milliseconds>(duration).count());
+	}
+	void sleepFor(uint32_t timeMs); // Sleeps unless wake() is called, advances the clock instead if it's simulated, returns at once without a sleeper
+	void wake(); // Interrupts runFor()'s sleep, can be called from any thread
+	void thisTaskWillWait(uint32_t delay, std::coroutine_handle<> resumed);
+	void thisTaskIsNowLowPriority(std::coroutine_handle<> resumed);
+	int thisTaskIsParked(std::coroutine_handle<> resumed); // Won't run until unparked, returns its index
+	void unpark(int task);
+
+	void unparkFromAnyThread(UnparkRequest* request); // Lock-free
+	// The destructor waits until every hold is released, so that other threads that will use it later can't outlive it
+	void holdForOtherThread();
+	void releaseFromOtherThread();
 	
 	bool addTask(Task&& added);
-	template <typename T, typename Allocator>
-	bool addTask(Awaitable<T, Allocator>* added) {
-		TaskEntry* place = addTaskHelper();
-		if (!place)
+	Task detachReadyTask(); // Removes a task that has to run now if there's another one, so that another scheduler can run it
+	void addTaskFromAnyThread(Task&& added); // Lock-free, the task is added when the scheduler runs next time
+
+	// The queue is asked for a batch of work before every task, returns false if it already has another one
+	template <typename Queue>
+	bool setWorkQueue(Queue* queue) {
+		if (_workQueue && _workQueue != queue)
 			return false;
-		*reinterpret_cast<Awaitable<T, Allocator>**>(&place->memory) = added;
-		place->depended = currentCoroutine();
-		_entries[place->depended].timestamp = place->timestamp;
-		place->run = [] (TaskEntry* self, SchedulerBase* scheduler, bool justDestroy) {
-			Awaitable<T, Allocator>*& awaitable = reinterpret_cast<Awaitable<T, Allocator>*&>(self->memory);
-			if (justDestroy || !awaitable->operator()()) {
-				self->flags = TaskEntry::NO_FLAGS;
-				awaitable = nullptr;
-				if (self->depended != TaskEntry::NOT_DEPENDED) {
-					scheduler->_entries[self->depended].flags = decltype(TaskEntry::flags)(scheduler->_entries[self->depended].flags ^ TaskEntry::AWAITING);
-					self->depended = TaskEntry::NOT_DEPENDED;
-				}
-			}
+		_workQueue = queue;
+		_runWork = [] (void* queue) {
+			return static_cast<Queue*>(queue)->runBatch();
+		};
+		_hasWork = [] (const void* queue) {
+			return !static_cast<const Queue*>(queue)->empty();
 		};
-		_entries[place->depended].flags = decltype(TaskEntry::flags)(_entries[place->depended].flags | TaskEntry::AWAITING);
 		return true;
-	};
+	}
+	void removeWorkQueue(const void* queue) { // Does nothing if it's not the scheduler's queue
+		if (_workQueue == queue)
+			_workQueue = nullptr;
+	}
 };
 
-template <int size>
-class Scheduler : public SchedulerBase {
-	std::array<TaskEntry, size> taskSpace;
+// Keeps the clock if it has a state, constructed before SchedulerBase reads it
+template <typename Clock, bool STATELESS = requires { Clock::now(); }>
+class SchedulerClock {
+	Clock _clock;
+protected:
+	void* instance() {
+		return &_clock;
+	}
+	static uint32_t timeOf(const void* clock) {
+		return static_cast<const Clock*>(clock)->now();
+	}
 public:
-	Scheduler() : SchedulerBase(taskSpace.data(), size) {}
+	Clock& clock() {
+		return _clock;
+	}
 };
 
-template <typename T, typename Allocator>
-bool Awaitable<T, Allocator>::await_ready() {
-	getScheduler()->addTask(this);
-	return false;
-}
+template <typename Clock>
+class SchedulerClock<Clock, true> {
+protected:
+	void* instance() {
+		return nullptr;
+	}
+	static uint32_t timeOf(const void*) {
+		return Clock::now();
+	}
+public:
+	Clock clock() {
+		return Clock();
+	}
+};
 
-template <int ElementCount = 16, int Size = 80>
-struct StaticAllocator {
-	class StaticAllocatingSpace {
-		alignas(void*) std::array<int8_t, ElementCount * Size> buffer;
-		std::array<bool, ElementCount> usage;
-		static_assert(Size % sizeof(void*) == 0, "ElementSize must be divisible by pointer size");
-		friend struct StaticAllocator;
-	};
-	static inline StaticAllocatingSpace _space;
+// Constructed before SchedulerBase and destroyed after it, its destructor may sleep until other threads are done with it
+template <typename Sleeper>
+struct SchedulerSleeper {
+	[[no_unique_address]] Sleeper _sleeper;
+};
 
-	StaticAllocator() = default;
-	template <int OtherElementCount, int OtherSize> constexpr StaticAllocator(const StaticAllocator<OtherElementCount, OtherSize>&) noexcept {}
+// If frameSize is set, Scheduler::Task allocates frames up to that size in a static space for size tasks
+// The space is shared by all instances of the same Scheduler type, which may run on different threads or create tasks for each other
+template <int size, typename Clock = SteadyClock, int frameSize = 0, typename Sleeper = DefaultSleeper<Clock>>
+class Scheduler : public SchedulerClock<Clock>, SchedulerSleeper<Sleeper>, public SchedulerBase {
+	std::array<TaskEntry, size> taskSpace;
+	std::array<int16_t, size> deadlineSpace;
+	static_assert(size <= std::numeric_limits<int16_t>::max(), "Task indexes must fit into int16_t");
+	static auto advanceClock() {
+		void (*advance)(void*, uint32_t) = nullptr;
+		if constexpr (requires (Clock clock) { clock.advance(uint32_t()); })
+			advance = [] (void* clock, uint32_t timeMs) {
+				static_cast<Clock*>(clock)->advance(timeMs);
+			};
+		return advance;
+	}
+public:
+	using FrameAllocator = ConcurrentStaticAllocator<size, frameSize, Scheduler>;
+	using Task = std::conditional_t<frameSize == 0, ::Task, BasicTask<FrameAllocator>>;
+	Scheduler() : SchedulerBase(taskSpace.data(), deadlineSpace.data(), size, &SchedulerClock<Clock>::timeOf, advanceClock(), this->instance()) {
+		if constexpr (!std::is_same_v<Sleeper, NoSleeper>) {
+			_sleeper = &this->SchedulerSleeper<Sleeper>::_sleeper;
+			_sleep = [] (void* sleeper, uint32_t timeMs) {
+				static_cast<Sleeper*>(sleeper)->sleep(timeMs);
+			};
+			_wakeSleeper = [] (void* sleeper) {
+				static_cast<Sleeper*>(sleeper)->wake();
+			};
+		}
+	}
+};
 
-	static void* allocate(size_t n) {
-		if (n <= Size) {
-			for (int i = 0; i < ElementCount; i++) {
-				if (!_space.usage[i]) {
-					_space.usage[i] = true;
-					return _space.buffer.data() + Size * i;
-				}
-			}
+// Wakes up a task from any thread, it's signalled until a task awaits it, only one task can await it at a time
+class Event {
+	static inline char markers[3];
+	static constexpr void* SIGNALLED = &markers[0];
+	static constexpr void* WAKING = &markers[1]; // A signal took the awaiter and is unparking its task
+	static constexpr void* WAKING_SIGNALLED = &markers[2]; // Signalled again while waking, becomes SIGNALLED then
+	std::atomic<void*> _state = nullptr; // nullptr, one of the markers or the waiting Awaiter
+
+	struct Awaiter : SchedulerBase::UnparkRequest {
+		Event* event;
+		SchedulerBase* scheduler = nullptr;
+		Awaiter(Event* event) : event(event) {}
+		Awaiter(const Awaiter&) = delete;
+		~Awaiter() {
+			void* expected = this; // The task was destroyed while waiting, the event must not unpark it
+			if (!event->_state.compare_exchange_strong(expected, nullptr))
+				while (event->waking()); // A signal may still be using this and the scheduler, it must not disappear before
+		}
+		bool await_ready() {
+			return event->consume();
 		}
-		return new int8_t[n];
+		bool await_suspend(std::coroutine_handle<> handle);
+		void await_resume() {}
+	};
+
+	bool consume() {
+		void* expected = SIGNALLED;
+		return _state.compare_exchange_strong(expected, nullptr);
+	}
+	bool waking() const {
+		void* state = _state.load(std::memory_order_acquire);
+		return state == WAKING || state == WAKING_SIGNALLED;
 	}
 
-	static void deallocate(void* pointer, size_t n) noexcept {
-		if (pointer >= _space.buffer.data() && pointer < _space.buffer.data() + Size * ElementCount) {
-			int index = reinterpret_cast<int8_t*>(pointer) - _space.buffer.data();
-			index /= Size;
-			_space.usage[index] = false;
-		} else
-			delete reinterpret_cast<int8_t*>(pointer);
+public:
+	Event() = default;
+	Event(const Event&) = delete;
+	void signal(); // Lock-free
+	bool signalled() const {
+		void* state = _state.load();
+		return state == SIGNALLED || state == WAKING_SIGNALLED;
+	}
+	Awaiter operator co_await() {
+		return Awaiter(this);
 	}
 };
 
-template <int Size, int OtherSize>
-bool operator==(const StaticAllocator<Size>&, const StaticAllocator<OtherSize>&) { return true; }
-template <int Size, int OtherSize>
-bool operator!=(const StaticAllocator<Size>&, const StaticAllocator<OtherSize>&) { return false; }
-
 #endif // SCHEDULER_DUGI_HPP
@@ -0,0 +1,150 @@
+#ifndef SCHEDULER_POOL_DUGI_HPP
+#define SCHEDULER_POOL_DUGI_HPP
+
+#include "scheduler.hpp"
+#include <thread>
+
+// Chase-Lev deque of fixed size, the owner pushes and pops at the bottom, others steal from the top
+template <typename T, int CAPACITY>
+class StealingDeque {
+	static_assert((CAPACITY & (CAPACITY - 1)) == 0, "Capacity must be a power of two");
+	alignas(64) std::atomic<int64_t> _top = 0;
+	alignas(64) std::atomic<int64_t> _bottom = 0;
+	std::array<std::atomic<T*>, CAPACITY> _items = {};
+
+public:
+	bool push(T* item) { // Owner only
+		int64_t bottom = _bottom.load(std::memory_order_relaxed);
+		int64_t top = _top.load(std::memory_order_acquire);
+		if (bottom - top >= CAPACITY)
+			return false;
+		_items[bottom & (CAPACITY - 1)].store(item, std::memory_order_relaxed);
+		_bottom.store(bottom + 1, std::memory_order_release);
+		return true;
+	}
+
+	T* pop() { // Owner only
+		int64_t bottom = _bottom.load(std::memory_order_relaxed) - 1;
+		_bottom.store(bottom, std::memory_order_seq_cst);
+		int64_t top = _top.load(std::memory_order_seq_cst);
+		if (top > bottom) {
+			_bottom.store(bottom + 1, std::memory_order_relaxed);
+			return nullptr;
+		}
+		T* item = _items[bottom & (CAPACITY - 1)].load(std::memory_order_relaxed);
+		if (top == bottom) { // The last one, a thief may be taking it
+			if (!_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+				item = nullptr;
+			_bottom.store(bottom + 1, std::memory_order_relaxed);
+		}
+		return item;
+	}
+
+	T* steal() { // Any thread
+		int64_t top = _top.load(std::memory_order_seq_cst);
+		int64_t bottom = _bottom.load(std::memory_order_seq_cst);
+		if (top >= bottom)
+			return nullptr;
+		T* item = _items[top & (CAPACITY - 1)].load(std::memory_order_relaxed);
+		if (!_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+			return nullptr;
+		return item;
+	}
+
+	int size() const {
+		return std::max<int64_t>(0, _bottom.load(std::memory_order_relaxed) - _top.load(std::memory_order_relaxed));
+	}
+};
+
+// Runs tasks on several threads, each with its own scheduler, threads without work take tasks that other threads can't run in time
+template <int threads, int tasksPerThread>
+class SchedulerPool {
+	constexpr static int SHARED_CAPACITY = [] {
+		int capacity = 1;
+		while (capacity < tasksPerThread)
+			capacity *= 2;
+		return capacity;
+	}();
+	constexpr static int SHARED_MAX = 2; // Ready tasks the worker offers to others at a time
+	constexpr static uint32_t STEALING_PERIOD = 10; // How often idle workers look for work even if not woken
+
+	struct Worker {
+		Scheduler<tasksPerThread> scheduler;
+		StealingDeque<void, SHARED_CAPACITY> shared; // Addresses of ready tasks' frames
+		std::atomic<int> taskCount = 0;
+		std::thread thread;
+	};
+	std::array<Worker, threads> _workers;
+	std::atomic<bool> _running = true;
+	std::atomic<int> _nextAdded = 0;
+	std::atomic<int> _nextWoken = 0;
+
+	bool tryToTake(Worker& worker, int index) {
+		if (worker.scheduler.taskCount() >= tasksPerThread)
+			return false;
+		void* taken = worker.shared.pop();
+		for (int i = 1; i < threads && !taken; i++)
+			taken = _workers[(index + i) % threads].shared.steal();
+		if (!taken)
+			return false;
+		worker.scheduler.addTask(Task::fromAddress(taken));
+		return true;
+	}
+
+	void share(Worker& worker, int index) {
+		while (worker.shared.size() < SHARED_MAX) {
+			Task detached = worker.scheduler.detachReadyTask();
+			if (!detached)
+				return;
+			worker.shared.push(detached.release());
+			if constexpr (threads > 1) // Another worker may be sleeping
+				_workers[(index + 1 + _nextWoken++ % (threads - 1)) % threads].scheduler.wake();
+		}
+	}
+
+	void work(int index) {
+		Worker& worker = _workers[index];
+		while (_running.load(std::memory_order_relaxed)) {
+			share(worker, index);
+			if (worker.scheduler.runATask() || tryToTake(worker, index)) {
+				worker.taskCount.store(worker.scheduler.taskCount(), std::memory_order_relaxed);
+				continue;
+			}
+			worker.taskCount.store(worker.scheduler.taskCount(), std::memory_order_relaxed);
+			worker.scheduler.sleepFor(std::min(worker.scheduler.timeLeft(), STEALING_PERIOD));
+		}
+	}
+
+public:
+	SchedulerPool() {
+		for (int i = 0; i < threads; i++)
+			_workers[i].thread = std::thread([this, i] { work(i); });
+	}
+	SchedulerPool(const SchedulerPool&) = delete;
+
+	~SchedulerPool() {
+		_running = false;
+		for (Worker& worker : _workers) {
+			worker.scheduler.wake();
+			worker.thread.join();
+		}
+		for (Worker& worker : _workers)
+			while (void* left = worker.shared.pop())
+				Task::fromAddress(left); // Destroys it
+	}
+
+	void addTask(Task&& added) { // Can be called from any thread
+		_workers[_nextAdded++ % threads].scheduler.addTaskFromAnyThread(std::move(added));
+	}
+
+	// Not exact, tasks being passed between threads may not be counted
+	int taskCount() const {
+		int count = 0;
+		for (const Worker& worker : _workers)
+			count += worker.taskCount.load(std::memory_order_relaxed) + worker.shared.size();
+		return count;
+	}
+	constexpr static int threadCount = threads;
+};
+
+#endif // SCHEDULER_POOL_DUGI_HPP
@@ -0,0 +1,127 @@
+#ifndef SIGNAL_H
+#define SIGNAL_H
+#include "function.hpp"
+#include "work_queue.hpp"
+#include <array>
+#include <limits>
+#include <type_traits>
+
+template <typename T, int MaxSlots = 8, size_t bufferSize = sizeof(void*) * 2>
+class Signal;
+
+// Calls all connected functions when emitted, in the order they were connected
+// If it's given a scheduler's WorkQueue, each call is posted to it, so that slow slots don't delay the emitter
+template <int MaxSlots, size_t bufferSize, typename... Args>
+class Signal<void(Args...), MaxSlots, bufferSize> {
+	using Slot = Function<void(Args...), bufferSize>;
+	constexpr static int DISCONNECTED = -1;
+
+	// Connected slots are packed at the start, so that emitting doesn't skip anything
+	std::array<Slot, MaxSlots> _slots;
+	std::array<int, MaxSlots> _connections;
+	int _size = 0;
+	int _nextConnection = 0;
+	bool _emitting = false;
+	bool _disconnectedWhileEmitting = false;
+	void* _queue = nullptr;
+	bool (*_post)(void* queue, const Slot& slot, const std::decay_t<Args>&... args) = nullptr;
+
+	void removeDisconnected() {
+		int kept = 0;
+		for (int i = 0; i < _size; i++) {
+			if (_connections[i] == DISCONNECTED)
+				continue;
+			_slots[kept] = _slots[i];
+			_connections[kept] = _connections[i];
+			kept++;
+		}
+		_size = kept;
+	}
+
+public:
+	Signal() = default;
+	// The queue's functions must have space for a slot and the arguments, the arguments must be trivially copyable
+	template <int N, int BATCH, size_t workSize>
+	explicit Signal(WorkQueue<N, BATCH, workSize>& queue) : _queue(&queue) {
+		_post = [] (void* queue, const Slot& slot, const std::decay_t<Args>&... args) {
+			return static_cast<WorkQueue<N, BATCH, workSize>*>(queue)->post([slot, args...] { slot(args...); });
+		};
+	}
+	Signal(const Signal&) = delete;
+
+	// Returns the connection's handle, -1 if there's no space
+	int connect(const Slot& slot) {
+		if (_size == MaxSlots)
+			return -1;
+		_slots[_size] = slot;
+		_connections[_size] = _nextConnection;
+		_size++;
+		_nextConnection = (_nextConnection + 1) & std::numeric_limits<int>::max();
+		return _connections[_size - 1];
+	}
+
+	template <auto method, typename T>
+	int connect(T* object) {
+		return connect(bindMethod<method>(object));
+	}
+
+	// Can be called from a slot, even the one that is being called, returns false if it wasn't connected
+	bool disconnect(int connection) {
+		for (int i = 0; i < _size; i++) {
+			if (_connections[i] != connection)
+				continue;
+			_connections[i] = DISCONNECTED;
+			if (_emitting)
+				_disconnectedWhileEmitting = true; // Removed after emitting, not to move slots that are being iterated
+			else
+				removeDisconnected();
+			return true;
+		}
+		return false;
+	}
+
+	void disconnectAll() {
+		for (int i = 0; i < _size; i++)
+			_connections[i] = DISCONNECTED;
+		if (_emitting)
+			_disconnectedWhileEmitting = true;
+		else
+			_size = 0;
+	}
+
+	// Slots connected while emitting are called the next time
+	// Returns false if some calls didn't fit into the queue, those are lost
+	bool emit(Args... args) {
+		if (_queue) {
+			bool posted = true;
+			for (int i = 0; i < _size; i++)
+				posted &= _post(_queue, _slots[i], args...);
+			return posted;
+		}
+		bool nested = _emitting;
+		_emitting = true;
+		for (int i = 0, size = _size; i < size; i++)
+			if (_connections[i] != DISCONNECTED)
+				_slots[i](args...);
+		_emitting = nested;
+		if (!_emitting && _disconnectedWhileEmitting) {
+			_disconnectedWhileEmitting = false;
+			removeDisconnected();
+		}
+		return true;
+	}
+
+	bool operator()(Args... args) {
+		return emit(args...);
+	}
+
+	int size() const {
+		return _size;
+	}
+	bool empty() const {
+		return _size == 0;
+	}
+	constexpr static int capacity = MaxSlots;
+};
+
+#endif // SIGNAL_H
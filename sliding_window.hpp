@@ -0,0 +1,100 @@
+#ifndef SLIDING_WINDOW_H
+#define SLIDING_WINDOW_H
+#include "circular_buffer.hpp"
+#include <type_traits>
+
+// Keeps the last CAPACITY values and their sum, minimum and maximum without going through all of them
+template <typename T, int CAPACITY = 8, typename Engine = InlineEngine>
+class SlidingWindow {
+	static_assert(std::is_arithmetic_v<T>, "Only numbers can be aggregated");
+	using Sum = std::conditional_t<std::is_floating_point_v<T>, double, std::conditional_t<std::is_signed_v<T>, int64_t, uint64_t>>;
+
+	struct Candidate {
+		T value;
+		uint32_t sequence; // Which push added it
+	};
+
+	CircularQueue<T, CAPACITY, Engine> _values;
+	// Values that can still become the minimum or maximum, each one is better than all that came before it
+	CircularQueue<Candidate, CAPACITY, Engine> _minima;
+	CircularQueue<Candidate, CAPACITY, Engine> _maxima;
+	Sum _sum = 0;
+	uint32_t _pushed = 0;
+
+	template <typename Better>
+	static void add(CircularQueue<Candidate, CAPACITY, Engine>& candidates, Candidate added, Better better) {
+		while (!candidates.empty() && !better(candidates.back().value, added.value))
+			candidates.popBack();
+		candidates.pushBack(added);
+	}
+
+public:
+	// Removes the oldest value if full
+	void push(T value) {
+		if (_values.full()) {
+			uint32_t dropped = _pushed - CAPACITY;
+			_sum -= _values.front();
+			if (_minima.front().sequence == dropped)
+				_minima.popFront();
+			if (_maxima.front().sequence == dropped)
+				_maxima.popFront();
+		}
+		_values.pushBackOverwriting(value);
+		_sum += value;
+		add(_minima, {value, _pushed}, [] (T older, T newer) { return older < newer; });
+		add(_maxima, {value, _pushed}, [] (T older, T newer) { return older > newer; });
+		_pushed++;
+		if constexpr (std::is_floating_point_v<T>) {
+			// Adding and subtracting accumulates rounding errors and would keep a NaN or infinity in the sum forever
+			if (_values.full() && _pushed % CAPACITY == 0) {
+				_sum = 0;
+				for (int i = 0; i < CAPACITY; i++) { // Rotating a full queue once leaves it as it was
+					T kept = _values.front();
+					_sum += kept;
+					_values.popFront();
+					_values.pushBack(kept);
+				}
+			}
+		}
+	}
+
+	void clear() {
+		_values.commit(_values.size());
+		_minima.commit(_minima.size());
+		_maxima.commit(_maxima.size());
+		_sum = 0;
+	}
+
+	// The rest must not be called if empty
+	Sum sum() const {
+		return _sum;
+	}
+	double mean() const {
+		return double(_sum) / _values.size();
+	}
+	T min() const {
+		return _minima.front().value;
+	}
+	T max() const {
+		return _maxima.front().value;
+	}
+	T oldest() const {
+		return _values.front();
+	}
+	T newest() const {
+		return _values.back();
+	}
+
+	int size() const {
+		return _values.size();
+	}
+	bool empty() const {
+		return _values.empty();
+	}
+	bool full() const {
+		return _values.full();
+	}
+	constexpr static int capacity = CAPACITY;
+};
+
+#endif // SLIDING_WINDOW_H
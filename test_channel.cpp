@@ -0,0 +1,72 @@
+//usr/bin/g++ --std=c++20 -Wall $0 scheduler.cpp circular_buffer.cpp -o ${o=`mktemp`} && exec $o $*
+#include "channel.hpp"
+#include <iostream>
+
+Task produce(Channel<int, 2>& channel, int count) {
+	for (int i = 1; i <= count; i++) {
+		co_await channel.send(i);
+		std::cout << "Sent " << i << std::endl;
+	}
+}
+
+Task consumeSlowly(Channel<int, 2>& channel, int count, int& sum) {
+	for (int i = 0; i < count; i++) {
+		int received = co_await channel.receive();
+		std::cout << "Received " << received << std::endl;
+		sum += received;
+		co_await waitForMs(10);
+	}
+}
+
+Task consumeInBatches(Channel<int, 2>& channel, int count, int& batches) {
+	CircularQueue<int, 4> batch;
+	int received = 0;
+	while (received < count) {
+		int got = co_await channel.receiveAll(batch);
+		std::cout << "Received a batch of " << got << ":";
+		while (!batch.empty()) {
+			std::cout << " " << batch.front();
+			batch.popFront();
+		}
+		std::cout << std::endl;
+		received += got;
+		batches++;
+	}
+}
+
+int main() {
+	{
+		Scheduler<4, SimulatedClock> scheduler;
+		Channel<int, 2> channel;
+		int sum = 0;
+		scheduler.addTask(consumeSlowly(channel, 6, sum));
+		scheduler.addTask(produce(channel, 6));
+		scheduler.runFor(1000);
+		std::cout << "Sum (21) " << sum << ", tasks left (0) " << scheduler.taskCount() << std::endl;
+	}
+
+	{
+		Scheduler<4, SimulatedClock> scheduler;
+		Channel<int, 2> channel;
+		int batches = 0;
+		scheduler.addTask(consumeInBatches(channel, 5, batches));
+		scheduler.runUntilIdle();
+		std::cout << "Parked consumer is not run (0) " << scheduler.runUntilIdle() << std::endl;
+		scheduler.addTask(produce(channel, 5));
+		scheduler.runUntilIdle();
+		std::cout << "Batches (2) " << batches << ", tasks left (0) " << scheduler.taskCount() << std::endl;
+	}
+
+	{
+		Channel<int, 2> channel;
+		std::cout << "Try send (1 1 0) " << channel.trySend(1) << " " << channel.trySend(2) << " " << channel.trySend(3) << std::endl;
+		std::cout << "Try receive (1) " << *channel.tryReceive() << std::endl;
+		{
+			Scheduler<2> scheduler;
+			scheduler.addTask(produce(channel, 5));
+			scheduler.runUntilIdle();
+			std::cout << "Size with a parked sender (2) " << channel.size() << std::endl;
+		}
+		std::cout << "Receive after the parked sender was destroyed (2 1) " << *channel.tryReceive() << " " << *channel.tryReceive() << std::endl;
+	}
+}
@@ -1,6 +1,8 @@
-//usr/bin/g++ --std=c++17 -Wall $0 circular_buffer.cpp -o ${o=`mktemp`} && exec $o $*
+//usr/bin/g++ --std=c++20 -Wall $0 circular_buffer.cpp -o ${o=`mktemp`} && exec $o $*
 #include "circular_buffer.hpp"
 #include <iostream>
+#include <algorithm>
+#include <numeric>
 
 int main() {
 
@@ -36,6 +38,91 @@ int main() {
 	buffer2.popFront();
 	std::cout << "Size (0/2) " << buffer2.size() << std::endl;
 
+	std::cout << std::endl;
+	std::cout << "Ring" << std::endl;
+	CircularQueue<int, 3> ring;
+	ring.pushBack(1);
+	ring.pushBack(2);
+	ring.pushBack(3);
+	std::cout << "Pushing into full (0) " << ring.pushBack(4) << ", front (1) " << ring.front() << ", size (3) " << ring.size() << std::endl;
+	ring.pushBackOverwriting(4);
+	ring.pushBackOverwriting(5);
+	std::cout << "Overwriting, front (3) " << ring.front() << ", back (5) " << ring.back() << ", size (3) " << ring.size() << std::endl;
+	ring.popBack();
+	std::cout << "Popped back, back (4) " << ring.back() << ", size (2) " << ring.size() << std::endl;
+	CircularQueue<int, 3, InlineEngine> inlineRing;
+	for (int i = 1; i <= 5; i++)
+		inlineRing.pushBackOverwriting(i);
+	std::cout << "Inline engine overwriting, front (3) " << inlineRing.front() << ", back (5) " << inlineRing.back() << ", pushing (0) " << inlineRing.pushBack(6) << std::endl;
+
+	std::cout << std::endl;
+	std::cout << "Inline engine" << std::endl;
+	CircularQueue<int, 3, InlineEngine> inlined;
+	inlined.pushBack(3);
+	inlined.pushBack(4);
+	inlined.popFront();
+	inlined.pushBack(5);
+	inlined.pushBack(6);
+	std::cout << "Full (1) " << inlined.full() << ", front (4) " << inlined.front() << std::endl;
+	inlined.popFront();
+	inlined.popFront();
+	std::cout << "Front (6) " << inlined.front() << ", size (1) " << inlined.size() << std::endl;
+	CircularQueue<int, 100000, InlineEngine>* large = new CircularQueue<int, 100000, InlineEngine>;
+	for (int i = 0; i < 50000; i++)
+		large->pushBack(i);
+	std::cout << "Size beyond the compact limit (50000) " << large->size() << std::endl;
+	delete large;
+
+	std::cout << std::endl;
+	std::cout << "Iterators" << std::endl;
+	CircularQueue<int, 4> iterated;
+	for (int i = 1; i <= 4; i++)
+		iterated.pushBack(i);
+	iterated.popFront();
+	iterated.popFront();
+	iterated.pushBack(5); // Wraps
+	iterated.pushBack(6);
+	std::cout << "Elements (3 4 5 6)";
+	for (int element : iterated)
+		std::cout << " " << element;
+	std::cout << std::endl;
+	std::cout << "Sum (18) " << std::accumulate(iterated.begin(), iterated.end(), 0) << ", third (5) " << iterated.begin()[2] << std::endl;
+	std::cout << "First over 4 (5) " << *std::find_if(iterated.begin(), iterated.end(), [] (int element) { return element > 4; }) << std::endl;
+	std::sort(iterated.begin(), iterated.end(), std::greater<int>());
+	std::cout << "Sorted in place, front (6) " << iterated.front() << ", back (3) " << iterated.back() << std::endl;
+	const CircularQueue<int, 4>& constant = iterated;
+	std::cout << "Distance (4) " << std::distance(constant.begin(), constant.end()) << std::endl;
+#ifdef __cpp_lib_concepts
+	static_assert(std::random_access_iterator<CircularQueue<int, 4>::iterator>);
+	static_assert(std::random_access_iterator<CircularQueue<int, 4>::const_iterator>);
+#endif
+
+#ifdef __cpp_lib_span
+	std::cout << std::endl;
+	std::cout << "Bulk" << std::endl;
+	CircularQueue<int, 5> bulk;
+	bulk.pushBack(0);
+	bulk.pushBack(0);
+	bulk.popFront();
+	bulk.popFront();
+	int burst[] = {1, 2, 3, 4, 5, 6};
+	std::cout << "Pushed (5) " << bulk.pushBack(std::span<const int>(burst)) << ", full (1) " << bulk.full() << std::endl;
+	std::cout << "Contiguous before the wrap (3) " << bulk.peekContiguous().size() << std::endl;
+	std::cout << "Spans (1 2 3 | 4 5)";
+	for (std::span<int> part : bulk.peek()) {
+		for (int element : part)
+			std::cout << " " << element;
+		std::cout << " |";
+	}
+	std::cout << std::endl;
+	bulk.commit(1);
+	int popped[3] = {};
+	std::cout << "Popped (3: 2 3 4) " << bulk.popFront(std::span<int>(popped)) << ": " << popped[0] << " " << popped[1] << " " << popped[2] << std::endl;
+	std::cout << "Front (5) " << bulk.front() << ", size (1) " << bulk.size() << std::endl;
+	bulk.commit(1);
+	std::cout << "Empty after commit (1) " << bulk.empty() << ", contiguous (0) " << bulk.peekContiguous().size() << std::endl;
+#endif
+
 	std::cout << std::endl;
 	std::cout << "Buffer" << std::endl;
 	struct Inside {
@@ -55,4 +142,28 @@ int main() {
 	std::cout << "Extracting 4. (4.4) " << buffer3.extract(4).value << std::endl;
 	std::cout << "Size is (should be 0) " << buffer3.size() << std::endl;
 	std::cout << "Can get 4 now? (shouldn't) " << bool(buffer3.tryGet(4)) << std::endl;
+
+	CircularBuffer<Inside, &Inside::index, 3, InlineEngine> buffer4;
+	buffer4.insert({3.3, 3});
+	buffer4.insert({4.4, 4});
+	buffer4.insert({5.5, 5});
+	std::cout << "Inline engine, extracting 4 (4.4) " << buffer4.extract(4).value << std::endl;
+	std::cout << "Are 3 and 5 there? (1 1) " << buffer4.has(3) << " " << buffer4.has(5) << ", is 4? (0) " << buffer4.has(4) << std::endl;
+
+	CircularBuffer<Inside, &Inside::index, 100, CompactEngine, true> keyed;
+	for (int i = 0; i < 100; i++)
+		keyed.insert({i * 1.5f, i});
+	for (int i = 0; i < 60; i++)
+		keyed.extract(i);
+	for (int i = 100; i < 150; i++)
+		keyed.insert({i * 1.5f, i}); // Wraps around the end
+	std::cout << "Key column, size (90) " << keyed.size() << ", has 59 (0) " << keyed.has(59) << ", has 60 and 149 (1 1) " << keyed.has(60) << " " << keyed.has(149) << std::endl;
+	std::cout << "Key column, get 120 (180) " << keyed.get(120).value << ", extract 70 (105) " << keyed.extract(70).value << ", has 70 (0) " << keyed.has(70) << std::endl;
+	int found = 0;
+	for (int i = 0; i < 200; i++)
+		found += keyed.has(i);
+	std::cout << "Key column, keys found (89) " << found << std::endl;
+	std::cout << "Key column, counted by iterating (89) " << std::count_if(keyed.begin(), keyed.end(), [] (const Inside& element) { return element.index < 200; }) << std::endl;
+	std::cout << "Without the key column, as large as a queue (" << sizeof(CircularQueue<Inside, 8, CompactEngine>) << ") " << sizeof(CircularBuffer<Inside, &Inside::index, 8>)
+			<< ", with it, larger by the keys (" << sizeof(CircularQueue<Inside, 8, CompactEngine>) + 8 * sizeof(int) << ") " << sizeof(CircularBuffer<Inside, &Inside::index, 8, CompactEngine, true>) << std::endl;
 }
@@ -0,0 +1,92 @@
+//usr/bin/g++ --std=c++17 -Wall $0 -o ${o=`mktemp`} -pthread && exec $o $*
+#include "concurrent_queue.hpp"
+#include <iostream>
+#include <thread>
+#include <vector>
+
+int main() {
+	std::cout << "SpscQueue" << std::endl;
+	{
+		SpscQueue<int, 3> queue;
+		std::cout << "Empty (1) " << queue.empty() << std::endl;
+		std::cout << "Pushed (1 1 1 0) " << queue.pushBack(3) << " " << queue.pushBack(4) << " " << queue.pushBack(5) << " " << queue.pushBack(6) << std::endl;
+		std::cout << "Full (1) " << queue.full() << ", size (3) " << queue.size() << std::endl;
+		std::cout << "Front (3) " << queue.front() << std::endl;
+		queue.popFront();
+		queue.popFront();
+		std::cout << "Pushed after wrapping (1) " << queue.pushBack(7) << std::endl;
+		std::cout << "Front (5) " << queue.front() << std::endl;
+		queue.popFront();
+		std::cout << "Front (7) " << queue.front() << std::endl;
+		queue.popFront();
+		std::cout << "Empty (1) " << queue.empty() << ", size (0) " << queue.size() << std::endl;
+	}
+
+	{
+		constexpr int COUNT = 100000;
+		SpscQueue<int, 16> queue;
+		std::thread producer([&] {
+			for (int i = 0; i < COUNT; i++)
+				while (!queue.pushBack(i))
+					std::this_thread::yield();
+		});
+		int outOfOrder = 0;
+		for (int expected = 0; expected < COUNT; expected++) {
+			while (queue.empty())
+				std::this_thread::yield();
+			outOfOrder += queue.front() != expected;
+			queue.popFront();
+		}
+		producer.join();
+		std::cout << "Passed between threads out of order (0) " << outOfOrder << std::endl;
+	}
+
+	std::cout << "MpmcQueue" << std::endl;
+	{
+		MpmcQueue<int, 4> queue;
+		std::cout << "Pop from empty (0) " << bool(queue.tryPop()) << std::endl;
+		int pushed[] = {1, 2, 3, 4, 5, 6};
+		std::cout << "Pushed in bulk (3) " << queue.tryPushBulk(pushed, 3) << std::endl;
+		std::cout << "Pushed in bulk past capacity (1) " << queue.tryPushBulk(pushed + 3, 3) << ", full (1) " << queue.full() << std::endl;
+		std::cout << "Pushed to full (0) " << queue.tryPush(7) << std::endl;
+		std::cout << "Popped (1) " << *queue.tryPop() << std::endl;
+		std::cout << "Pushed after wrapping (1) " << queue.tryPush(5) << std::endl;
+		int popped[8] = {};
+		int count = queue.tryPopBulk(popped, 8);
+		std::cout << "Popped in bulk (4: 2 3 4 5) " << count << ":";
+		for (int i = 0; i < count; i++)
+			std::cout << " " << popped[i];
+		std::cout << std::endl;
+		std::cout << "Empty (1) " << queue.empty() << std::endl;
+	}
+
+	{
+		constexpr int THREADS = 4;
+		constexpr int COUNT = 20000; // Per producer
+		MpmcQueue<int, 16> queue;
+		std::atomic<int64_t> sum = 0;
+		std::atomic<int> received = 0;
+		std::vector<std::thread> threads;
+		for (int t = 0; t < THREADS; t++) {
+			threads.emplace_back([&] {
+				for (int i = 1; i <= COUNT; i++)
+					while (!queue.tryPush(i))
+						std::this_thread::yield();
+			});
+			threads.emplace_back([&] {
+				int batch[4];
+				while (received < THREADS * COUNT) {
+					int got = queue.tryPopBulk(batch, 4);
+					for (int i = 0; i < got; i++)
+						sum += batch[i];
+					received += got;
+					if (!got)
+						std::this_thread::yield();
+				}
+			});
+		}
+		for (std::thread& thread : threads)
+			thread.join();
+		std::cout << "Sum from " << THREADS << " producers to " << THREADS << " consumers (" << int64_t(THREADS) * COUNT * (COUNT + 1) / 2 << ") " << sum << std::endl;
+	}
+}
@@ -0,0 +1,66 @@
+//usr/bin/g++ --std=c++17 -Wall $0 -o ${o=`mktemp`} && exec $o $*
+#include "fixed_hash_map.hpp"
+#include <iostream>
+#include <map>
+#include <random>
+#include <type_traits>
+
+struct Request {
+	int id;
+	float sent;
+};
+
+int main() {
+	FixedHashMap<Request, &Request::id, 3> map;
+	std::cout << "Trivially copyable (1) " << std::is_trivially_copyable_v<decltype(map)> << std::endl;
+	map.insert({3, 3.3});
+	map.insert({4, 4.4});
+	std::cout << "Size is (should be 2) " << map.size() << std::endl;
+	std::cout << "Is 3 there? (should be) " << map.has(3) << std::endl;
+	std::cout << "Is 5 there? (shouldn't be) " << map.has(5) << std::endl;
+	std::cout << "What is on 4? (4.4) " << map.get(4).sent << std::endl;
+	map.insert({4, 4.5});
+	std::cout << "Replaced 4, size (2) " << map.size() << ", value (4.5) " << map.get(4).sent << std::endl;
+	map.insert({5, 5.5});
+	std::cout << "Inserting into full (0) " << map.insert({6, 6.6}) << ", has 6 (0) " << map.has(6) << std::endl;
+	std::cout << "Extracting 3. (3.3) " << map.extract(3).sent << std::endl;
+	std::cout << "Is 3 there? (shouldn't be) " << map.has(3) << std::endl;
+	std::cout << "Can get 3 now? (shouldn't) " << bool(map.tryGet(3)) << ", can extract 5 (1) " << bool(map.tryExtract(5)) << std::endl;
+	std::cout << "Size is (should be 1) " << map.size() << std::endl;
+
+	FixedHashMap<Request, &Request::id, 3, true> cache;
+	for (int i = 1; i <= 5; i++)
+		cache.insert({i, i * 1.1f});
+	std::cout << "Evicting, has 1 2 (0 0) " << cache.has(1) << " " << cache.has(2) << ", has 3 4 5 (1 1 1) " << cache.has(3) << " " << cache.has(4) << " " << cache.has(5) << std::endl;
+	cache.extract(4);
+	cache.insert({6, 6.6});
+	cache.insert({7, 7.7});
+	std::cout << "Evicted in order of insertion, has 3 (0) " << cache.has(3) << ", has 5 6 7 (1 1 1) " << cache.has(5) << " " << cache.has(6) << " " << cache.has(7) << std::endl;
+
+	// Compared with std::map under random use, many keys collide in buckets
+	FixedHashMap<Request, &Request::id, 200> large;
+	std::map<int, float> reference;
+	std::mt19937 random(3);
+	int mismatches = 0;
+	for (int i = 0; i < 200000; i++) {
+		int key = int(random() % 400) * 1024;
+		switch (random() % 3) {
+		case 0:
+			if (large.insert({key, float(i)}))
+				reference[key] = float(i);
+			else
+				mismatches += reference.size() != 200 || reference.count(key);
+			break;
+		case 1: {
+			std::optional<Request> extracted = large.tryExtract(key);
+			mismatches += bool(extracted) != bool(reference.count(key)) || (extracted && extracted->sent != reference[key]);
+			reference.erase(key);
+			break;
+		}
+		default:
+			mismatches += large.has(key) != bool(reference.count(key));
+		}
+		mismatches += large.size() != int(reference.size());
+	}
+	std::cout << "Differences from std::map (0) " << mismatches << std::endl;
+}
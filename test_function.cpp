@@ -1,6 +1,21 @@
-//usr/bin/g++ --std=c++17 -Wall $0 -o ${o=`mktemp`} && exec $o $*
+//usr/bin/g++ --std=c++20 -Wall $0 -o ${o=`mktemp`} && exec $o $*
 #include "function.hpp"
 #include <iostream>
+#include <memory>
+#include <string>
+
+struct Counted {
+	static inline int alive = 0;
+	Counted() {
+		alive++;
+	}
+	Counted(const Counted&) {
+		alive++;
+	}
+	~Counted() {
+		alive--;
+	}
+};
 
 struct Point {
 	int x;
@@ -14,6 +29,34 @@ struct Point {
 	}
 };
 
+struct Frame {
+	static inline int copies = 0;
+	int data[32] = {};
+	Frame() = default;
+	Frame(const Frame& other) {
+		copies++;
+		std::copy(other.data, other.data + 32, data);
+	}
+	Frame(Frame&&) = default;
+};
+
+int twice(int value) {
+	return value * 2;
+}
+
+constexpr Function<int(int), 0> operations[] = {
+	[](int value) { return value + 1; },
+	[](int value) { return twice(value); },
+};
+
+// Doesn't keep the callback, so it needs no copy of it
+int sumOfMapped(const int* values, int count, FunctionRef<int(int)> mapping) {
+	int sum = 0;
+	for (int i = 0; i < count; i++)
+		sum += mapping(values[i]);
+	return sum;
+}
+
 int main() {
 	Function<void(int), 8> a = [](int printed) {
 		std::cout << "Printing " << printed << std::endl;
@@ -43,4 +86,48 @@ int main() {
 	d();
 
 	std::cout << "Sizes " << sizeof(a) << " " << sizeof(b) << std::endl;
+
+	UniqueFunction<void(int), 48> e = [owned = std::make_unique<int>(10), name = std::string("unique")] (int added) {
+		std::cout << "Printing " << name << " " << *owned + added << std::endl;
+	};
+	e(5);
+	UniqueFunction<void(int), 48> f = std::move(e);
+	std::cout << "Moved, empty (0 1) " << bool(e) << " " << bool(f) << std::endl;
+	f(6);
+	e = a; // From a Function
+	e(7);
+
+	{
+		UniqueFunction<int()> g = [counted = Counted()] { return Counted::alive; };
+		std::cout << "Alive when stored (1) " << g() << std::endl;
+		UniqueFunction<int()> h;
+		h = std::move(g);
+		std::cout << "Alive after moving (1) " << h() << std::endl;
+		h = [] { return -1; };
+		std::cout << "Alive after replacing (0) " << Counted::alive << std::endl;
+		h = [counted = Counted()] { return Counted::alive; };
+	}
+	std::cout << "Alive after destruction (0) " << Counted::alive << std::endl;
+	std::cout << "Sizes " << sizeof(e) << std::endl;
+
+	std::cout << "Table (4 6) " << operations[0](3) << " " << operations[1](3) << std::endl;
+	std::cout << "Sizes of stateless (8) " << sizeof(operations[0]) << std::endl;
+	constexpr Function<int(int)> withBuffer = [](int value) { return value - 1; };
+	std::cout << "Constant with a buffer (2) " << withBuffer(3) << std::endl;
+
+	Function<int(Frame)> i = [](Frame frame) { return frame.data[0]; };
+	Frame frame;
+	frame.data[0] = 42;
+	std::cout << "Large argument (42 1) " << i(frame) << " " << Frame::copies << std::endl;
+
+	int values[] = { 1, 2, 3 };
+	int64_t large[8] = { 10 };
+	std::string suffix = "not copied";
+	auto heavy = [large, suffix](int value) { return int(large[0]) + value; };
+	std::cout << "Reference to large (36) " << sumOfMapped(values, 3, heavy) << std::endl;
+	std::cout << "Reference to function (12) " << sumOfMapped(values, 3, twice) << std::endl;
+	std::cout << "Reference to Function (12) " << sumOfMapped(values, 3, operations[1]) << std::endl;
+	int calls = 0;
+	std::cout << "Reference to mutable (6 3) " << sumOfMapped(values, 3, [&calls](int value) mutable { calls++; return value; }) << " " << calls << std::endl;
+	std::cout << "Sizes of reference (16) " << sizeof(FunctionRef<int(int)>) << std::endl;
 }
@@ -0,0 +1,79 @@
+//usr/bin/g++ --std=c++17 -Wall $0 mapped_circular_queue.cpp -o ${o=`mktemp`} && exec $o $*
+#include "mapped_circular_queue.hpp"
+#include <iostream>
+#include <cstdio>
+#include <sys/wait.h>
+#include <unistd.h>
+
+struct Event {
+	int64_t time;
+	int32_t code;
+};
+
+int main() {
+	const char* path = "/tmp/test_mapped_circular_queue.bin";
+	remove(path);
+	{
+		MappedCircularQueue<Event> queue(path, 4);
+		std::cout << "Opened (1) " << bool(queue) << ", empty (1) " << queue.empty() << ", capacity (4) " << queue.capacity() << std::endl;
+		queue.pushBack({100, 1});
+		queue.pushBack({200, 2});
+		Event* reserved = queue.reserveBack();
+		reserved->time = 300;
+		reserved->code = 3;
+		std::cout << "Size before commit (2) " << queue.size() << std::endl;
+		queue.commitBack();
+		std::cout << "Size after commit (3) " << queue.size() << ", front (1) " << queue.front().code << std::endl;
+	}
+
+	{
+		MappedCircularQueue<Event> reopened(path, 4);
+		std::cout << "Reopened, size (3) " << reopened.size() << ", codes (1 2 3) " << reopened[0].code << " " << reopened[1].code << " " << reopened[2].code << std::endl;
+		reopened.pushBack({400, 4});
+		std::cout << "Pushing into full (0) " << reopened.pushBack({500, 5}) << std::endl;
+		reopened.pushBackOverwriting({500, 5});
+		std::cout << "Overwriting, front (2) " << reopened.front().code << ", size (4) " << reopened.size() << std::endl;
+		reopened.popFront();
+		std::cout << "Popped, front (3) " << reopened.front().code << std::endl;
+	}
+
+	std::cout << "Different capacity refused (0) " << bool(MappedCircularQueue<Event>(path, 8)) << std::endl;
+	std::cout << "Different element size refused (0) " << bool(MappedCircularQueue<int>(path, 4)) << std::endl;
+
+	// A child process records events and crashes, the parent finds them in the file
+	pid_t child = fork();
+	if (child == 0) {
+		MappedCircularQueue<Event> recorder(path, 0, 2);
+		for (int i = 6; i <= 9; i++)
+			recorder.pushBackOverwriting({i * 100, i});
+		abort();
+	}
+	waitpid(child, nullptr, 0);
+	MappedCircularQueue<Event> survived(path, 0);
+	std::cout << "After the crash, size (4) " << survived.size() << ", codes (6 7 8 9)";
+	for (int i = 0; i < survived.size(); i++)
+		std::cout << " " << survived[i].code;
+	std::cout << std::endl;
+	remove(path);
+
+	std::cout << "Reading a missing file fails (0) " << bool(MappedCircularQueue<Event>(path, 0));
+	std::cout << ", leaves no file (0) " << (access(path, F_OK) == 0) << std::endl;
+
+	// Processes create it at once, only one initialises it, the others use it or fail if it's not initialised yet
+	constexpr int CREATORS = 4;
+	for (int i = 0; i < CREATORS; i++) {
+		if (fork() == 0) {
+			MappedCircularQueue<Event> created(path, 8);
+			_exit(created && created.pushBack({i, i}) ? 0 : 1);
+		}
+	}
+	int pushed = 0;
+	for (int i = 0; i < CREATORS; i++) {
+		int status = 0;
+		wait(&status);
+		pushed += WIFEXITED(status) && WEXITSTATUS(status) == 0;
+	}
+	MappedCircularQueue<Event> shared(path, 8);
+	std::cout << "Created at once, all pushes kept (1) " << (bool(shared) && shared.size() == pushed) << std::endl;
+	remove(path);
+}
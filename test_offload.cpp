@@ -0,0 +1,91 @@
+//usr/bin/g++ --std=c++20 -Wall -pthread $0 scheduler.cpp -o ${o=`mktemp`} && exec $o $*
+#include "offload.hpp"
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+
+std::string compress(const std::string& chunk) {
+	std::this_thread::sleep_for(std::chrono::milliseconds(50)); // Pretends to be heavy
+	std::string compressed;
+	for (size_t i = 0; i < chunk.size(); i++) {
+		size_t repeated = 1;
+		while (i + 1 < chunk.size() && chunk[i + 1] == chunk[i]) {
+			repeated++;
+			i++;
+		}
+		compressed += std::to_string(repeated) + chunk[i];
+	}
+	return compressed;
+}
+
+// Moved out, it can't be copied
+Awaitable<std::unique_ptr<std::string>> compressChunk(std::string chunk) {
+	// Not created inside co_await, GCC 12 destroys such lambdas wrongly if their captures have destructors
+	auto compressing = [chunk] { return compress(chunk); };
+	std::string compressed = co_await offload(std::move(compressing));
+	co_return std::make_unique<std::string>(compressed);
+}
+
+Task compressLog(std::string& result, std::thread::id& computedOn) {
+	std::unique_ptr<std::string> compressed = co_await compressChunk("aaabccccd");
+	result = *compressed;
+	co_await offload([&computedOn] { computedOn = std::this_thread::get_id(); });
+}
+
+Task tick(int& ticks) {
+	while (true) {
+		ticks++;
+		co_await waitForMs(5);
+	}
+}
+
+int main() {
+	{
+		Scheduler<4> scheduler;
+		std::string result;
+		std::thread::id computedOn;
+		int ticks = 0;
+		scheduler.addTask(compressLog(result, computedOn));
+		scheduler.addTask(tick(ticks));
+		scheduler.runFor(std::chrono::milliseconds(100));
+		std::cout << "Compressed (3a1b4c1d) " << result << std::endl;
+		std::cout << "Computed on another thread (1) " << (computedOn != std::thread::id() && computedOn != std::this_thread::get_id()) << std::endl;
+		std::cout << "Other tasks kept running, ticks (about 20) " << ticks << std::endl;
+		std::cout << "Only the ticking task is left (1) " << scheduler.taskCount() << std::endl;
+	}
+
+	{
+		WorkerPool<2, 4> pool;
+		Scheduler<16> scheduler;
+		int sum = 0;
+		auto addSquare = [&] (int value) -> Task {
+			sum += co_await offload(pool, [value] { return value * value; });
+		};
+		for (int i = 1; i <= 10; i++) // More than fits into the pool, the rest runs right away
+			scheduler.addTask(addSquare(i));
+		auto start = std::chrono::steady_clock::now();
+		while (scheduler.taskCount() > 0 && std::chrono::steady_clock::now() - start < std::chrono::seconds(1))
+			scheduler.runFor(std::chrono::milliseconds(10));
+		std::cout << "Sum of squares (385) " << sum << std::endl;
+	}
+
+	{
+		WorkerPool<1, 4> pool;
+		int result = 0;
+		auto start = std::chrono::steady_clock::now();
+		{
+			Scheduler<2> scheduler;
+			auto computeSlowly = [&] () -> Task {
+				result = co_await offload(pool, [] {
+					std::this_thread::sleep_for(std::chrono::milliseconds(50));
+					return 7;
+				});
+			};
+			scheduler.addTask(computeSlowly());
+			scheduler.runUntilIdle();
+		} // Destroyed while the worker computes, it waits for it
+		std::cout << "Destroyed in the middle of offloading, result not delivered (0) " << result << ", waited in ms (about 50) "
+				<< std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count() << std::endl;
+	}
+}
@@ -1,3 +1,4 @@
+//usr/bin/g++ --std=c++20 -Wall $0 scheduler.cpp -o ${o=`mktemp`} && exec $o $*
 #include "scheduler.hpp"
 #include <iostream>
 #include <chrono>
@@ -40,7 +41,270 @@ Task slack() {
 	}
 }
 
+StaticAwaitable<int> addOne(int value) {
+	co_return value + 1;
+}
+
+StaticAwaitable<int> addTwo(int value) {
+	co_return co_await addOne(co_await addOne(value));
+}
+
+Task computeQuickly(int& result) {
+	result = co_await addTwo(co_await addTwo(1));
+}
+
+Task reactToEvents(Event& event, int& reactions) {
+	while (true) {
+		co_await event;
+		reactions++;
+	}
+}
+
+Task runOnce(int& ran) {
+	ran++;
+	co_return;
+}
+
+using ArenaScheduler = Scheduler<4, SteadyClock, 256>;
+
+ArenaScheduler::Task countInArena(int& counted) {
+	for (int i = 0; i < 3; i++) {
+		counted++;
+		co_await waitForMs(0);
+	}
+}
+
+using Slabs = SlabAllocator<SlabClass<64, 4>, SlabClass<128, 4>, SlabClass<256, 2>>;
+
+template <typename T>
+using SlabAwaitable = Awaitable<T, Slabs>;
+
+SlabAwaitable<int> small(int value) {
+	co_await waitForMs(1);
+	co_return value;
+}
+
+SlabAwaitable<int> large(int value) {
+	std::array<int, 40> kept = {};
+	kept[value % 40] = value;
+	co_await waitForMs(1);
+	co_return kept[value % 40] + co_await small(value);
+}
+
+Task useSlabs(int& sum) {
+	sum += co_await large(1) + co_await small(2);
+}
+
+Task finishLater(int delay, int& previous, bool& ordered) {
+	co_await waitForMs(delay);
+	if (delay < previous)
+		ordered = false;
+	previous = delay;
+}
+
+Task keepBusy(int& rounds) {
+	while (true) {
+		rounds++;
+		co_await waitSomeTime();
+	}
+}
+
+Task controlLoop(int& iterations) {
+	while (true) {
+		iterations++;
+		co_await waitForMs(1000);
+	}
+}
+
 int main() {
+	{
+		Scheduler<256, SimulatedClock> large;
+		int previous = 0;
+		bool ordered = true;
+		for (int i = 0; i < 200; i++)
+			large.addTask(finishLater((i * 37) % 200, previous, ordered));
+		std::cout << "Tasks (should be 200) " << large.taskCount() << std::endl;
+		large.runFor(1000); // Jumps from deadline to deadline, so the order doesn't depend on how fast it runs
+		std::cout << "Finished in order? (should be) " << ordered << ", tasks left (0) " << large.taskCount() << std::endl;
+	}
+
+
+	{
+		Scheduler<1> single;
+		int result = 0;
+		single.addTask(computeQuickly(result));
+		single.runATask();
+		std::cout << "Nested awaitables in one slot and one run, result (5) " << result << ", tasks left (0) " << single.taskCount() << std::endl;
+	}
+
+	{
+		using Allocator = StaticAllocator<3, 16>;
+		void* first = Allocator::allocate(16);
+		void* second = Allocator::allocate(8);
+		Allocator::deallocate(first, 16);
+		void* third = Allocator::allocate(16);
+		void* fourth = Allocator::allocate(16);
+		void* fifth = Allocator::allocate(16);
+		std::cout << "Reused freed space (1) " << (first == third) << ", in use (3) " << Allocator::statistics().inUse
+				<< ", high water mark (3) " << Allocator::statistics().highWaterMark << ", heap fallbacks (1) " << Allocator::statistics().heapFallbacks << std::endl;
+		for (void* allocated : {second, third, fourth, fifth})
+			Allocator::deallocate(allocated, 16);
+		std::cout << "In use after freeing (0) " << Allocator::statistics().inUse << std::endl;
+
+		using Concurrent = ConcurrentStaticAllocator<64, 16>;
+		std::array<std::thread, 4> threads;
+		for (std::thread& thread : threads)
+			thread = std::thread([] {
+				for (int i = 0; i < 10000; i++) {
+					std::array<void*, 16> allocated;
+					for (void*& it : allocated)
+						it = Concurrent::allocate(16);
+					for (void* it : allocated)
+						Concurrent::deallocate(it, 16);
+				}
+			});
+		for (std::thread& thread : threads)
+			thread.join();
+		std::cout << "Concurrent allocator in use (0) " << Concurrent::statistics().inUse << ", high water mark (at most 64) " << Concurrent::statistics().highWaterMark
+				<< ", heap fallbacks (0) " << Concurrent::statistics().heapFallbacks << std::endl;
+	}
+
+	{
+		Scheduler<4> scheduler;
+		int sum = 0;
+		for (int i = 0; i < 3; i++)
+			scheduler.addTask(useSlabs(sum));
+		scheduler.runFor(20);
+		std::cout << "Sum with slab allocated frames (12) " << sum << ", frame sizes " << frameSize([] { return small(0); }) << " and " << frameSize([] { return large(0); }) << std::endl;
+		for (const SlabClassStatistics& slab : Slabs::classStatistics())
+			std::cout << "Slab of " << slab.count << " times " << slab.size << " bytes, in use (0) " << slab.usage.inUse << ", most in use " << slab.usage.highWaterMark << std::endl;
+		std::cout << "Slab heap fallbacks (1, three large frames at once) " << Slabs::statistics().heapFallbacks << std::endl;
+	}
+
+	{
+		int counted = 0;
+		std::cout << "Frame size of a task in the arena " << frameSize([&] { return countInArena(counted); }) << std::endl;
+		std::cout << "Frame size if no frame was allocated (0) " << frameSize([] { return 0; }) << std::endl;
+		ArenaScheduler arena;
+		for (int i = 0; i < 5; i++)
+			arena.addTask(countInArena(counted));
+		arena.runFor(10);
+		std::cout << "Counted in the arena (12) " << counted << ", frames on heap (1) " << ArenaScheduler::FrameAllocator::statistics().heapFallbacks
+				<< ", largest frame " << ArenaScheduler::Task::frameStatistics().largest
+				<< ", allocations (6) " << ArenaScheduler::Task::frameStatistics().allocations << std::endl;
+	}
+
+	{
+		// Schedulers of the same type share the arena
+		int counted[2] = {};
+		auto useArena = [&counted] (int index) {
+			ArenaScheduler arena;
+			for (int round = 0; round < 1000; round++) {
+				arena.addTask(countInArena(counted[index]));
+				arena.addTask(countInArena(counted[index]));
+				arena.runUntilIdle();
+			}
+		};
+		std::thread first(useArena, 0);
+		std::thread second(useArena, 1);
+		first.join();
+		second.join();
+		std::cout << "Counted in arenas on two threads (6000 6000) " << counted[0] << " " << counted[1]
+				<< ", frames in use (0) " << ArenaScheduler::FrameAllocator::statistics().inUse << std::endl;
+	}
+
+	{
+		Scheduler<4, SimulatedClock> simulated;
+		int iterations = 0;
+		simulated.addTask(controlLoop(iterations));
+		auto start = std::chrono::steady_clock::now();
+		simulated.runFor(std::chrono::hours(1));
+		std::cout << "Simulated an hour, iterations (3601) " << iterations << ", simulated time (3600000) " << simulated.clock().now()
+				<< ", real time taken in ms (about 0) " << std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count() << std::endl;
+		Scheduler<4, SimulatedClock> other;
+		std::cout << "Another simulated scheduler has its own time (0) " << other.clock().now() << std::endl;
+	}
+
+	{
+		Scheduler<2> scheduler;
+		Event event;
+		int reactions = 0;
+		int ran = 0;
+		scheduler.addTask(reactToEvents(event, reactions));
+		std::thread other([&] {
+			for (int i = 0; i < 3; i++) {
+				std::this_thread::sleep_for(std::chrono::milliseconds(20));
+				event.signal();
+				scheduler.addTaskFromAnyThread(runOnce(ran));
+				scheduler.addTaskFromAnyThread(runOnce(ran));
+			}
+		});
+		auto start = std::chrono::steady_clock::now();
+		scheduler.runFor(std::chrono::milliseconds(100));
+		other.join();
+		std::cout << "Reactions to events from another thread (3) " << reactions << ", tasks added from another thread ran (6) " << ran
+				<< ", real time taken in ms (about 100) " << std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count() << std::endl;
+	}
+
+	{
+		Event event;
+		int reactions = 0;
+		{
+			Scheduler<2> scheduler;
+			scheduler.addTask(reactToEvents(event, reactions));
+			scheduler.runUntilIdle();
+		} // Destroyed while the task waits
+		event.signal();
+		std::cout << "Signalled after the waiting task was destroyed, reactions (0) " << reactions << ", signalled (1) " << event.signalled() << std::endl;
+	}
+
+	{
+		// Waiting tasks and their schedulers are destroyed while another thread keeps signalling
+		Event event;
+		std::atomic<bool> stop = false;
+		std::thread signaller([&] {
+			while (!stop)
+				event.signal();
+		});
+		int reactions = 0;
+		int destroyedWhileWaiting = 0;
+		for (int i = 0; i < 2000; i++) {
+			Scheduler<2> scheduler;
+			scheduler.addTask(reactToEvents(event, reactions));
+			scheduler.runUntilIdle();
+			destroyedWhileWaiting += scheduler.taskCount();
+		}
+		stop = true;
+		signaller.join();
+		std::cout << "Tasks destroyed while another thread signalled (2000) " << destroyedWhileWaiting << std::endl;
+	}
+
+	{
+		Scheduler<2> busy;
+		int rounds = 0;
+		busy.addTask(keepBusy(rounds));
+		auto start = std::chrono::steady_clock::now();
+		busy.runFor(50);
+		std::cout << "Ran with a task that is always ready for (about 50) " << std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count()
+				<< ", it ran many times (1) " << (rounds > 100) << std::endl;
+	}
+
+	{
+		std::cout << "Tickless" << std::endl;
+		Scheduler<16> tickless;
+		std::cout << "Time left with nothing to do (maximum) " << tickless.timeLeft() << std::endl;
+		tickless.addTask(chillOut());
+		tickless.addTask(slack());
+		std::cout << "Time left before starting (0) " << tickless.timeLeft() << std::endl;
+		int ran = tickless.runUntilIdle();
+		std::cout << "Ran at start (2) " << ran << std::endl;
+		std::cout << "Time left after starting (about 100) " << tickless.timeLeft() << std::endl;
+		auto start = std::chrono::steady_clock::now();
+		tickless.runFor(std::chrono::milliseconds(600));
+		std::cout << "Ran for (about 600) " << std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count() << std::endl;
+	}
+
+	std::cout << "Polling" << std::endl;
 	Scheduler<16> scheduler;
 	scheduler.addTask(messAround());
 	scheduler.addTask(chillOut());
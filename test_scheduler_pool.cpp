@@ -0,0 +1,48 @@
+//usr/bin/g++ --std=c++20 -Wall $0 scheduler.cpp -o ${o=`mktemp`} && exec $o $*
+#include "scheduler_pool.hpp"
+#include <iostream>
+
+Awaitable<int> stepLater(int step) {
+	co_await waitForMs(1);
+	co_return step + 1;
+}
+
+Task walk(std::atomic<int>& finished, std::atomic<int>& migrated) {
+	std::thread::id started = std::this_thread::get_id();
+	bool moved = false;
+	int step = 0;
+	while (step < 20) {
+		step = co_await stepLater(step);
+		co_await waitForMs(0);
+		if (std::this_thread::get_id() != started)
+			moved = true;
+	}
+	if (moved)
+		migrated++;
+	finished++;
+}
+
+int main() {
+	std::atomic<int> finished = 0;
+	std::atomic<int> migrated = 0;
+	{
+		SchedulerPool<4, 32> pool;
+		for (int i = 0; i < 100; i++)
+			pool.addTask(walk(finished, migrated));
+		auto start = std::chrono::steady_clock::now();
+		while (finished < 100 && std::chrono::steady_clock::now() - start < std::chrono::seconds(10))
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		std::cout << "Finished tasks (100) " << finished << ", tasks left (0) " << pool.taskCount() << std::endl;
+		std::cout << "Tasks that moved to another thread " << migrated << std::endl;
+		for (int i = 0; i < 10; i++)
+			pool.addTask(walk(finished, migrated));
+	}
+	std::cout << "Tasks left when destroyed were destroyed, finished (fewer than 110) " << finished << std::endl;
+
+	StealingDeque<int, 4> deque;
+	int values[5] = {1, 2, 3, 4, 5};
+	for (int& value : values)
+		deque.push(&value);
+	std::cout << "Deque size (4) " << deque.size() << ", stolen (1) " << *deque.steal() << ", popped (4) " << *deque.pop() << std::endl;
+}
@@ -0,0 +1,59 @@
+//usr/bin/g++ --std=c++20 -Wall $0 scheduler.cpp -o ${o=`mktemp`} && exec $o $*
+#include "signal.hpp"
+#include <iostream>
+
+struct Display {
+	int shown = 0;
+	void show(int value) {
+		shown = value;
+		std::cout << "Display shows " << value << std::endl;
+	}
+};
+
+int main() {
+	Signal<void(int), 4> changed;
+	int sum = 0;
+	Display display;
+	int first = changed.connect([&sum] (int value) { sum += value; });
+	int second = changed.connect<&Display::show>(&display);
+	changed(3);
+	std::cout << "Delivered (3 3) " << sum << " " << display.shown << std::endl;
+
+	changed.disconnect(first);
+	changed(5);
+	std::cout << "After disconnecting (3 5) " << sum << " " << display.shown << std::endl;
+	std::cout << "Disconnecting again (0) " << changed.disconnect(first) << std::endl;
+
+	for (int i = 0; i < 3; i++)
+		changed.connect([&sum] (int) { sum++; });
+	std::cout << "Connecting when full (-1) " << changed.connect([] (int) {}) << std::endl;
+	changed.disconnect(second);
+
+	// A slot that disconnects itself
+	int once = -1;
+	Signal<void(), 4, 24> fired;
+	int calls = 0;
+	fired.connect([&calls] { calls++; });
+	once = fired.connect([&fired, &once, &calls] { calls += 10; fired.disconnect(once); });
+	fired.connect([&calls] { calls += 100; });
+	fired();
+	fired();
+	std::cout << "Disconnected while emitting (212 2) " << calls << " " << fired.size() << std::endl;
+
+	{
+		Scheduler<4> scheduler;
+		WorkQueue<2, 4, 32> work(scheduler); // Space for two calls, each with a slot and an int
+		Signal<void(int), 4> posted(work);
+		int received = 0;
+		posted.connect([&received] (int value) { received += value; });
+		posted.connect([&received] (int value) { received += value * 10; });
+		std::cout << "Posted (1) " << posted(2);
+		std::cout << ", not yet delivered (0) " << received << std::endl;
+		scheduler.runUntilIdle();
+		std::cout << "Delivered by the scheduler (22) " << received << std::endl;
+		posted(1);
+		std::cout << "Posted when the queue is full (0) " << posted(1) << std::endl;
+		scheduler.runUntilIdle();
+		std::cout << "Delivered what fitted (33) " << received << std::endl;
+	}
+}
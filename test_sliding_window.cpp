@@ -0,0 +1,55 @@
+//usr/bin/g++ --std=c++17 -Wall $0 circular_buffer.cpp -o ${o=`mktemp`} && exec $o $*
+#include "sliding_window.hpp"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <random>
+
+int main() {
+	SlidingWindow<int, 3> window;
+	window.push(5);
+	window.push(1);
+	std::cout << "Size (2) " << window.size() << ", sum (6) " << window.sum() << ", mean (3) " << window.mean() << std::endl;
+	std::cout << "Min (1) " << window.min() << ", max (5) " << window.max() << std::endl;
+	window.push(3);
+	window.push(2); // Pushes 5 out
+	std::cout << "Full (1) " << window.full() << ", sum (6) " << window.sum() << ", min (1) " << window.min() << ", max (3) " << window.max() << std::endl;
+	window.push(4); // Pushes 1 out
+	std::cout << "Oldest (3) " << window.oldest() << ", newest (4) " << window.newest() << ", min (2) " << window.min() << ", max (4) " << window.max() << std::endl;
+	window.clear();
+	window.push(-7);
+	std::cout << "After clear, size (1) " << window.size() << ", min and max (-7 -7) " << window.min() << " " << window.max() << std::endl;
+
+	// Compared with going through all values every time
+	SlidingWindow<float, 50> floats;
+	CircularQueue<float, 50, InlineEngine> kept;
+	std::mt19937 random(5);
+	int mismatches = 0;
+	for (int i = 0; i < 10000; i++) {
+		float value = float(random() % 1000) / 10;
+		floats.push(value);
+		kept.pushBackOverwriting(value);
+		float minimum = kept.front();
+		float maximum = kept.front();
+		double sum = 0;
+		for (int j = 0; j < kept.size(); j++) {
+			float element = kept.front();
+			minimum = std::min(minimum, element);
+			maximum = std::max(maximum, element);
+			sum += element;
+			kept.popFront();
+			kept.pushBack(element);
+		}
+		mismatches += floats.min() != minimum || floats.max() != maximum || std::abs(floats.sum() - sum) > 0.01;
+	}
+	std::cout << "Differences from recomputing (0) " << mismatches << std::endl;
+
+	// The floating-point sum is recomputed when the window wraps, so errors and NaNs don't stay in it
+	SlidingWindow<double, 4> recomputed;
+	recomputed.push(std::nan(""));
+	for (int i = 0; i < 3; i++)
+		recomputed.push(1e20);
+	for (int i = 0; i < 4; i++)
+		recomputed.push(1); // The 8th push wraps the window the second time
+	std::cout << "Sum after a NaN and large values left (4) " << recomputed.sum() << std::endl;
+}
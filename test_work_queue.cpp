@@ -0,0 +1,83 @@
+//usr/bin/g++ --std=c++20 -Wall -pthread $0 scheduler.cpp -o ${o=`mktemp`} && exec $o $*
+#include "work_queue.hpp"
+#include <iostream>
+#include <thread>
+
+Task countTo(int limit, int& counted) {
+	while (counted < limit) {
+		counted++;
+		co_await waitSomeTime();
+	}
+}
+
+int main() {
+	{
+		Scheduler<4> scheduler;
+		WorkQueue<64, 16> work(scheduler);
+		int done = 0;
+		for (int i = 0; i < 40; i++)
+			work.post([&done] { done++; });
+		std::cout << "Nothing runs when posting (0 40) " << done << " " << work.size() << std::endl;
+		scheduler.runATask();
+		std::cout << "One batch (16) " << done << std::endl;
+		scheduler.runUntilIdle();
+		std::cout << "All of it (40) " << done << std::endl;
+	}
+
+	{
+		Scheduler<4> scheduler;
+		WorkQueue<64, 4> work(scheduler);
+		int counted = 0;
+		int done = 0;
+		scheduler.addTask(countTo(3, counted));
+		for (int i = 0; i < 8; i++)
+			work.post([&done, &counted] { std::cout << "Work after " << counted << " steps" << std::endl; done++; });
+		while (scheduler.runATask());
+		std::cout << "Work interleaved with a task (8 3) " << done << " " << counted << std::endl;
+	}
+
+	{
+		Scheduler<2, SimulatedClock> scheduler;
+		WorkQueue<8> work(scheduler);
+		scheduler.runATask();
+		scheduler.clock().advance(100);
+		uint32_t seen = 0;
+		work.post([&scheduler, &seen] { seen = scheduler.now(); });
+		scheduler.runATask();
+		std::cout << "Work sees the current time (0) " << scheduler.clock().now() - seen << std::endl;
+	}
+
+	{
+		Scheduler<2> scheduler;
+		Scheduler<2> otherScheduler;
+		WorkQueue<8> first(scheduler);
+		int done = 0;
+		{
+			WorkQueue<8> second(otherScheduler);
+			std::cout << "A scheduler takes only one queue (0) " << scheduler.setWorkQueue(&second) << std::endl;
+		}
+		first.post([&done] { done++; });
+		scheduler.runUntilIdle();
+		std::cout << "The first queue still runs (1) " << done << std::endl;
+	}
+
+	{
+		Scheduler<2> scheduler;
+		WorkQueue<256> work(scheduler);
+		int done = 0;
+		std::thread other([&] {
+			for (int i = 0; i < 100; i++) {
+				while (!work.post([&done] { done++; }))
+					std::this_thread::yield();
+				if (i % 25 == 0)
+					std::this_thread::sleep_for(std::chrono::milliseconds(10));
+			}
+		});
+		auto start = std::chrono::steady_clock::now();
+		scheduler.runFor(std::chrono::milliseconds(100));
+		other.join();
+		scheduler.runUntilIdle();
+		std::cout << "Posted from another thread (100) " << done
+				<< ", real time taken in ms (about 100) " << std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count() << std::endl;
+	}
+}
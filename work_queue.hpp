@@ -0,0 +1,52 @@
+#ifndef WORK_QUEUE_H
+#define WORK_QUEUE_H
+#include "scheduler.hpp"
+#include "concurrent_queue.hpp"
+#include "function.hpp"
+#include <cassert>
+
+// Short pieces of work that don't need a coroutine, the scheduler runs up to BATCH of them before every task
+// Any thread can post work without locking, it runs on the scheduler's thread
+template <int N = 64, int BATCH = 16, size_t bufferSize = sizeof(void*) * 2>
+class WorkQueue {
+	using Work = Function<void(), bufferSize>;
+	MpmcQueue<Work, N> _queue;
+	SchedulerBase& _scheduler;
+
+public:
+	WorkQueue(SchedulerBase& scheduler) : _scheduler(scheduler) {
+		[[maybe_unused]] bool set = scheduler.setWorkQueue(this);
+		assert(set && "A scheduler can have only one WorkQueue");
+	}
+	WorkQueue(const WorkQueue&) = delete;
+	~WorkQueue() {
+		_scheduler.removeWorkQueue(this);
+	}
+
+	// Returns false if it's full
+	bool post(const Work& work) {
+		if (!_queue.tryPush(work))
+			return false;
+		_scheduler.wake();
+		return true;
+	}
+
+	// Called by the scheduler, work posted while running is left for the next batch
+	int runBatch() {
+		Work batch[BATCH];
+		int count = _queue.tryPopBulk(batch, BATCH);
+		for (int i = 0; i < count; i++)
+			batch[i]();
+		return count;
+	}
+
+	bool empty() const {
+		return _queue.empty();
+	}
+	int size() const {
+		return _queue.size();
+	}
+	constexpr static int capacity = N;
+};
+
+#endif // WORK_QUEUE_H